@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+
+namespace httplib {
+class Server;
+struct Request;
+struct Response;
+}
+
+struct AdmissionConfig {
+    size_t workers = 0;            // 0 = max(8, hardware threads - 1), like cpp-httplib
+    size_t queueDepth = 256;       // queued connections before new ones are shed
+    long long targetDelayMs = 20;  // acceptable standing queue delay
+    long long intervalMs = 100;    // window the delay must stay above target
+    size_t writeSlots = 0;         // concurrent writes; 0 = half the workers
+    long long writeWaitMs = 100;   // how long a write may wait for a slot
+    long long retryAfterSec = 1;   // minimum Retry-After on 503
+    long long keepAliveSec = 1;    // idle keep-alive before a worker drops the connection
+};
+
+// Bounded worker pool + load shedding for the HTTP server.
+//
+// Connections wait in a bounded queue; the time each spent queued feeds a
+// CoDel-style detector. Normally a connection is shed only after queueing
+// for a whole interval, but once the minimum delay has stayed above target
+// for an interval the cutoff drops to the target itself, so a standing
+// queue drains quickly. Writes additionally need one of a limited number
+// of write slots, so workers blocked on WAL fsync can never take every
+// thread away from reads. Shed requests get an immediate 503 + Retry-After;
+// connections arriving while the queue is full get theirs from the accept
+// thread, without waiting for a worker.
+class AdmissionController {
+public:
+    struct Stats {
+        std::uint64_t admitted = 0;
+        std::uint64_t queued = 0;           // connections enqueued so far
+        std::uint64_t shedQueueDelay = 0;   // 503: waited past the CoDel cutoff
+        std::uint64_t shedQueueFull = 0;    // 503: queue at queueDepth
+        std::uint64_t shedWrites = 0;       // 503: no write slot within writeWaitMs
+        std::uint64_t rejected = 0;         // closed without a response (send failed)
+        size_t queueLength = 0;
+        size_t queuePeak = 0;
+        size_t writesInFlight = 0;
+        bool overloaded = false;
+        double queueDelayMs = 0;            // last observed queue delay
+        size_t workers = 0;
+        size_t queueDepth = 0;
+        size_t writeSlots = 0;
+    };
+
+    explicit AdmissionController(const AdmissionConfig& config);
+
+    // An httplib::Server whose connections go through the admission queue.
+    // The controller must outlive it.
+    std::unique_ptr<httplib::Server> makeServer();
+
+    // Pre-routing: true if the request may run. Otherwise res holds a 503.
+    bool admit(const httplib::Request& req, httplib::Response& res);
+
+    // Post-routing: frees the calling thread's write slot, if it holds one,
+    // and while connections are queued asks the client to close this one,
+    // so its worker moves on instead of idling on keep-alive.
+    void release(httplib::Response& res);
+
+    Stats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    friend class AdmissionQueue;
+    friend class AdmissionServer;
+
+    AdmissionConfig cfg;
+
+    // CoDel state, updated on every dequeue
+    mutable std::mutex codelMutex;
+    Clock::time_point windowEnd{};
+    Clock::duration windowMinDelay = Clock::duration::max();
+    bool overloaded = false;
+    Clock::duration lastDelay{};
+
+    // write slots
+    mutable std::mutex slotMutex;
+    std::condition_variable slotFreed;
+    size_t writesInFlight = 0;
+
+    std::atomic<std::uint64_t> admitted{0};
+    std::atomic<std::uint64_t> queued{0};
+    std::atomic<std::uint64_t> shedQueueDelay{0};
+    std::atomic<std::uint64_t> shedQueueFull{0};
+    std::atomic<std::uint64_t> shedWrites{0};
+    std::atomic<std::uint64_t> rejected{0};
+    std::atomic<size_t> queueLength{0};
+    std::atomic<size_t> queuePeak{0};
+
+    // called by AdmissionQueue: true if the connection should be shed
+    bool onDequeue(Clock::duration delay);
+
+    bool isWrite(const httplib::Request& req) const;
+    long long retryAfter() const;
+    void reject(httplib::Response& res, const char* reason);
+    // whole HTTP response for a connection shed before its request is read
+    std::string cannedReject(const char* reason) const;
+    void releaseSlot();
+};
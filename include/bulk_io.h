@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <functional>
+#include <cstdint>
+
+// One key/value pair as carried by /import and /export.
+// ttl is the remaining lifetime in seconds, -1 when the key never expires.
+// version is the key's version on the exporting node (0 = none); importing
+// keeps it so a key's ETag never goes backwards when it moves between nodes.
+struct BulkRecord {
+    std::string key;
+    std::string value;
+    long long ttl = -1;
+    std::uint64_t version = 0;
+};
+
+enum class BulkFormat {
+    NDJSON,   // one {"key":..,"value":..[,"ttl":..][,"ver":..]} object per line
+    Binary    // per record: u32 keyLen, u32 valueLen, i64 ttl, u64 ver (little-endian), key, value
+};
+
+// Parses "application/x-ndjson" / "application/octet-stream" style content types.
+BulkFormat bulkFormatFromContentType(const std::string& contentType);
+const char* bulkContentType(BulkFormat format);
+
+// Incremental decoder: feed() arbitrary slices of the stream (e.g. HTTP
+// chunks) and every complete record is handed to the callback. Only the
+// trailing partial record is buffered; records larger than the limits
+// below are rejected as soon as their header (or line) shows it.
+class BulkDecoder {
+public:
+    using RecordCallback = std::function<void(BulkRecord&&)>;
+
+    static constexpr size_t kMaxKeyBytes = 64 * 1024;
+    static constexpr size_t kMaxValueBytes = 64 * 1024 * 1024;
+
+    BulkDecoder(BulkFormat format, RecordCallback cb);
+
+    // returns false on malformed input; error() describes it
+    bool feed(const char* data, size_t len);
+
+    // call once the stream has ended; fails if a partial record is left over
+    bool finish();
+
+    const std::string& error() const { return err; }
+
+private:
+    BulkFormat format;
+    RecordCallback onRecord;
+    std::string pending;
+    size_t scanned = 0;   // NDJSON: prefix of pending already searched for '\n'
+    size_t line = 0;
+    std::string err;
+
+    bool parseLine(const std::string& text);
+    bool drainNdjson(bool final);
+    bool drainBinary();
+};
+
+// Appends one encoded record to out.
+void encodeBulkRecord(BulkFormat format, const BulkRecord& record, std::string& out);
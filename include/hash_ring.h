@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include <cstdint>
+
+// Consistent-hash ring. Each node is placed at `vnodes` pseudo-random
+// points; a key belongs to the first point clockwise from its hash, so
+// adding or removing a node only moves the keys adjacent to its points.
+class HashRing {
+public:
+    explicit HashRing(size_t vnodes = 160);
+
+    void addNode(const std::string& node);
+    void removeNode(const std::string& node);
+    bool hasNode(const std::string& node) const;
+
+    // owner of key; empty string if the ring is empty
+    const std::string& nodeFor(const std::string& key) const;
+
+    const std::vector<std::string>& nodes() const { return members; }
+    size_t vnodes() const { return vnodeCount; }
+    bool empty() const { return members.empty(); }
+
+    // Inclusive hash ranges [first, second] whose keys belong to node, in
+    // ascending order with adjacent ones merged; empty if it is not a member.
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> rangesFor(const std::string& node) const;
+
+    // 64-bit hash used for both keys and virtual node labels
+    static std::uint64_t hash(const std::string& s);
+
+private:
+    size_t vnodeCount;
+    std::map<std::uint64_t, std::string> ring;
+    std::vector<std::string> members;
+};
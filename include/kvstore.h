@@ -2,15 +2,39 @@
 #include <string>
 #include <unordered_map>
 #include <shared_mutex>
+#include <mutex>
 #include <vector>
+#include <list>
+#include <atomic>
+#include <cstdint>
 #include <chrono>
+#include <functional>
+#include "bulk_io.h"
 
 class Persistence;
-class LRUCache;
 
 class KeyValueStore {
 public:
-    explicit KeyValueStore(LRUCache* cachePtr = nullptr);
+    struct CacheStats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+    };
+
+    // Special values for the `expected` argument of putIf/delIf.
+    // Any other value must equal the key's current version.
+    static constexpr std::uint64_t ANY_VERSION = 0;                 // unconditional
+    static constexpr std::uint64_t MUST_EXIST = UINT64_MAX;         // If-Match: *
+    static constexpr std::uint64_t MUST_NOT_EXIST = UINT64_MAX - 1; // If-None-Match: *
+    static constexpr std::uint64_t NO_MATCH = UINT64_MAX - 2;       // If-Match: a tag never issued
+    // Highest version ever assigned. Versions read from imports or the WAL
+    // above it are ignored (the key gets the next version instead), and a
+    // write that would need a version past it throws std::overflow_error.
+    static constexpr std::uint64_t MAX_VERSION = NO_MATCH - 1;
+
+    // capacity: max live keys before the least recently used one is
+    // evicted; 0 = unbounded.
+    explicit KeyValueStore(size_t capacity = 0);
 
     bool put(const std::string& key, const std::string& value, bool persist = true);
     std::string get(const std::string& key, bool& found);
@@ -18,14 +42,64 @@ public:
     bool exists(const std::string& key);
     size_t size();
 
-    std::unordered_map<std::string, std::string> snapshot();
+    // ---------- VERSIONS ----------
+    // Every write takes the next value of a store-wide counter, so a key's
+    // version strictly increases and never repeats across keys.
+    std::string get(const std::string& key, bool& found, std::uint64_t& version);
 
-    void setPersistence(Persistence* p);
-    void attachCache(LRUCache* cachePtr);
+    // Writes only if `expected` holds. On success version is the new
+    // version; on failure it is the current one (0 if the key is absent).
+    bool putIf(const std::string& key, const std::string& value,
+               std::uint64_t expected, std::uint64_t& version, bool persist = true);
+    bool delIf(const std::string& key, std::uint64_t expected,
+               std::uint64_t& version, bool persist = true);
+
+    // WAL replay: reinstates a key at its logged version (0 = assign a new one).
+    // Versions are assigned under the store lock but logged after it is
+    // released, so the WAL can hold a key's records out of order; a SET older
+    // than the key's current version or its last replayed DEL is ignored, as
+    // is a DEL older than the current version. Version 0 (pre-versioning
+    // records) always applies.
+    void restore(const std::string& key, const std::string& value, std::uint64_t version);
+    void restoreDelete(const std::string& key, std::uint64_t version);
+    // Drops the DEL markers restoreDelete() keeps while replay is running.
+    void finishRestore();
+    // Moves the version counter to at least v (e.g. Persistence::replayedVersion()).
+    void advanceVersion(std::uint64_t v);
+    std::uint64_t currentVersion();
+
+    // All live keys with their versions, for WAL compaction.
+    std::vector<BulkRecord> snapshot();
 
-    void onCacheEvict(const std::string& key);
+    // ---------- BULK LOAD / DUMP ----------
+    // Inserts a batch under one lock, bypassing the WAL — the caller
+    // persists the batch. A record's version is kept if it is newer than the
+    // key's current one (a key moving between nodes keeps its ETag) and the
+    // counter is raised past it; otherwise the key gets the next version.
+    // Each record's version is updated to what was stored.
+    size_t putBatch(std::vector<BulkRecord>& records);
+
+    // Current records for the given keys under one shared lock; absent and
+    // expired keys are left out. Does not touch LRU order or hit counters.
+    std::vector<BulkRecord> getRecords(const std::vector<std::string>& keys);
+
+    // Visits every key live when the walk starts, as it was at that moment,
+    // without holding the lock while fn runs: the key set is copied once,
+    // then records are read `chunk` keys per shared lock. A key written or
+    // removed before the walk reaches it is reported from a pre-image the
+    // writer saves, so memory grows with the keys changed during the walk.
+    // If filter is set, only the keys it accepts are visited (it runs under
+    // the lock). Returning false from fn stops the walk.
+    using KeyFilter = std::function<bool(const std::string& key)>;
+    void forEach(const std::function<bool(const BulkRecord& record)>& fn,
+                 size_t chunk = 1024, const KeyFilter& filter = nullptr);
+
+    void setPersistence(Persistence* p);
 
-    LRUCache* getCache() const;
+    // ---------- LRU / CACHE STATS ----------
+    size_t capacity() const;
+    CacheStats getCacheStats() const;
+    void resetCacheStats();
 
     // ---------- TTL SUPPORT ----------
     void setTTL(const std::string& key, long long ttlSeconds);
@@ -33,17 +107,74 @@ public:
     bool isExpired(const std::string& key);
     void cleanupExpired();                      // background thread calls this
 
+#ifdef ALGOVAULT_OP_COUNTERS
+    // Instrumentation for algovault_bench: lock acquisitions and hash
+    // probes performed by the store since the last reset.
+    struct OpCounters {
+        std::atomic<std::uint64_t> locks{0};
+        std::atomic<std::uint64_t> probes{0};
+    };
+    static OpCounters& opCounters();
+#endif
+
 private:
-    std::unordered_map<std::string, std::string> store;
-    std::unordered_map<std::string, long long> expiry;  // epoch ms expiry
+    // Everything known about a key lives in one record, so a lookup is a
+    // single probe under a single lock acquisition.
+    struct Entry {
+        std::string value;
+        long long expiresAt = 0;                        // epoch ms, 0 = no TTL
+        std::uint64_t version = 0;                      // bumped on every write
+        std::list<const std::string*>::iterator lru;    // position in recency list
+    };
+
+    std::unordered_map<std::string, Entry> entries;
+    std::list<const std::string*> recency;             // front = most recently used
+    std::uint64_t lastVersion = 0;
+    size_t maxEntries;
+
+    std::unordered_map<std::string, std::uint64_t> replayedDeletes;  // key -> DEL version, replay only
+
+    // forEach walks in progress. The first change to a key at or below a
+    // walk's start version saves the old state for it.
+    struct PreImage {
+        std::string value;
+        long long expiresAt;
+        std::uint64_t version;
+    };
+    struct Walk {
+        std::uint64_t since;
+        const KeyFilter* filter;
+        std::unordered_map<std::string, PreImage> preImages;
+    };
+    std::vector<Walk*> walks;
+    std::mutex walksMutex;   // registration under a shared lock
 
     mutable std::shared_mutex mutex_;
 
     Persistence* persistence = nullptr;
-    LRUCache* cache = nullptr;
 
-    void onPut(const std::string& key, const std::string& value);
-    void onDelete(const std::string& key);
+    std::atomic<std::size_t> hits{0};
+    std::atomic<std::size_t> misses{0};
+    std::atomic<std::size_t> evictions{0};
+
+    // helpers below expect mutex_ to be held exclusively
+    Entry& upsertLocked(const std::string& key, const std::string& value,
+                        std::uint64_t version = 0);       // 0 = next version
+    Entry& linkLocked(std::unordered_map<std::string, Entry>::iterator it, bool inserted);
+    void eraseLocked(std::unordered_map<std::string, Entry>::iterator it);
+    void evictLocked(std::vector<std::string>& evicted);
+    void preserveLocked(const std::string& key, const Entry& e);
+    void checkVersionLocked() const;   // throws once lastVersion reaches MAX_VERSION
+
+    bool versionMatches(const Entry* e, std::uint64_t expected) const;
+
+    void onPut(const std::string& key, const std::string& value, std::uint64_t version);
+    void onDelete(const std::string& key, std::uint64_t version);
+    void logEvictions(const std::vector<std::string>& evicted);
+
+    bool expiredAt(const Entry& e, long long now) const {
+        return e.expiresAt != 0 && now > e.expiresAt;
+    }
 
     long long nowMs() const {
         return std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -5,11 +5,14 @@
 #include <vector>
 #include <unordered_map>
 #include <fstream>
+#include <cstdint>
+#include "bulk_io.h"
 
 struct LogEntry {
-    std::string op;   // "SET" or "DEL"
+    std::string op;   // "SET", "DEL" or "VER"
     std::string key;
     std::string value; // empty for DEL
+    std::uint64_t ver; // store version assigned to the write
     long long ts;
 };
 
@@ -20,21 +23,39 @@ public:
 
     ~Persistence();
 
-    // append a SET operation
-    bool appendSet(const std::string& key, const std::string& value);
+    // append a SET operation (version: the key's new version, 0 = none)
+    bool appendSet(const std::string& key, const std::string& value, std::uint64_t version = 0);
 
-    // append a DEL operation
-    bool appendDel(const std::string& key);
+    // append a DEL operation (version: the store version consumed by the delete)
+    bool appendDel(const std::string& key, std::uint64_t version = 0);
+
+    // append many SET operations in one write, without fsync.
+    // Used by bulk import; call sync() once the whole batch set is written.
+    bool appendSetBatch(const std::vector<BulkRecord>& records);
+
+    // append many DEL operations (key, version) in one write, without fsync.
+    bool appendDelBatch(const std::vector<std::pair<std::string, std::uint64_t>>& keys);
+
+    // fsync the WAL (commit point for appendSetBatch / appendDelBatch)
+    bool sync();
 
     // replay the WAL. callbacks are invoked in file order.
-    // setCb: (key, value) for SET
-    // delCb: (key) for DEL
-    bool replay(const std::function<void(const std::string&, const std::string&)>& setCb,
-                const std::function<void(const std::string&)>& delCb);
+    // setCb: (key, value, version) for SET; version is 0 for pre-versioning records
+    // delCb: (key, version) for DEL
+    // File order is not version order for a single key, so callers should
+    // apply records by version (see KeyValueStore::restore).
+    bool replay(const std::function<void(const std::string&, const std::string&, std::uint64_t)>& setCb,
+                const std::function<void(const std::string&, std::uint64_t)>& delCb);
+
+    // highest version seen by the last replay(), including DEL and VER records.
+    // The store must resume numbering above it so versions never repeat.
+    std::uint64_t replayedVersion() const;
 
-    // compact: overwrite wal with snapshot (map of current key->value)
-    // The snapshot should be consistent (caller provides).
-    bool compact(const std::unordered_map<std::string, std::string>& snapshot);
+    // compact: overwrite wal with snapshot (current key/value/version records)
+    // The snapshot should be consistent (caller provides). highVersion is the
+    // store's current version, kept in a leading VER record so versions of
+    // deleted keys are not reused after a restart.
+    bool compact(const std::vector<BulkRecord>& snapshot, std::uint64_t highVersion);
 
     // Get path (for debugging)
     std::string path() const;
@@ -42,6 +63,7 @@ public:
 private:
     std::string filepath;
     std::mutex fileMutex;
+    std::uint64_t maxReplayedVersion = 0;
 
     // helper: fsync after flush (posix available)
     void doFsync(std::ofstream& ofs);
@@ -0,0 +1,125 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include "hash_ring.h"
+#include "server.h"
+
+namespace httplib {
+class Client;
+class Result;
+}
+
+// Keep-alive connections to one node ("host:port"). Clients are handed out
+// one per request and returned afterwards, since httplib::Client is not
+// safe to share between concurrent requests. A lease keeps its pool alive,
+// so a node can leave the ring while requests to it are still running.
+class NodePool : public std::enable_shared_from_this<NodePool> {
+public:
+    class Lease {
+    public:
+        Lease(std::shared_ptr<NodePool> pool, std::unique_ptr<httplib::Client> cli);
+        Lease(Lease&&) = default;
+        ~Lease();
+        httplib::Client* operator->() { return cli.get(); }
+
+    private:
+        std::shared_ptr<NodePool> pool;
+        std::unique_ptr<httplib::Client> cli;
+    };
+
+    explicit NodePool(const std::string& node, size_t maxIdle = 64);
+    ~NodePool();
+
+    Lease acquire();
+    const std::string& node() const { return address; }
+
+private:
+    std::string address;
+    std::string host;
+    int port = 0;
+    size_t maxIdle;
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<httplib::Client>> idle;
+
+    void release(std::unique_ptr<httplib::Client> cli);
+};
+
+// Router mode: fronts several algovault nodes, placing keys with a
+// consistent-hash ring and forwarding the single-key API to the owner.
+class ClusterRouter {
+public:
+    ClusterRouter(const std::vector<std::string>& nodes, size_t vnodes = 160);
+
+    // serve the routed API; blocks like startServer()
+    void start(const ServerConfig& config);
+
+    // Rebalance: streams the key ranges that change owner, then switches the
+    // ring. Writes routed meanwhile keep going to the old owner; the keys
+    // they touch are copied again, with writes held, just before the switch,
+    // so no acknowledged write is lost. Returns the number of keys moved, or
+    // -1 and sets error.
+    long long addNode(const std::string& node, std::string& error);
+    long long removeNode(const std::string& node, std::string& error);
+
+    std::vector<std::string> nodes();
+    std::string ownerOf(const std::string& key);
+    // nullptr if the node is not (or no longer) part of the cluster
+    std::shared_ptr<NodePool> poolFor(const std::string& node);
+
+private:
+    HashRing ring;
+    std::map<std::string, std::shared_ptr<NodePool>> pools;
+    std::shared_mutex mutex_;          // guards ring, pools and next
+    std::mutex gate;                   // see sharedLock()
+    std::mutex rebalanceMutex;         // one rebalance at a time
+
+    // While a rebalance runs: the ring being moved to, and the keys written
+    // through the router whose owner differs between ring and *next.
+    std::unique_ptr<HashRing> next;
+    std::mutex dirtyMutex;
+    std::set<std::string> dirty;
+
+    // Sends a write for key to its owner while holding mutex_ shared, so the
+    // ring cannot switch mid-request; during a rebalance the node gets a
+    // short timeout. node is set to the owner.
+    httplib::Result forwardWrite(const std::string& key, std::string& node,
+                                 const std::function<httplib::Result(httplib::Client&)>& send);
+
+    // mutex_ through `gate`: glibc's rwlock prefers readers, so a steady
+    // stream of routed requests could otherwise starve a ring switch.
+    std::shared_lock<std::shared_mutex> sharedLock();
+    std::unique_lock<std::shared_mutex> exclusiveLock();
+
+    std::shared_ptr<NodePool> poolLocked(const std::string& node);
+    // starts / abandons a rebalance towards `target` (takes mutex_)
+    void beginRebalance(const HashRing& target);
+    void abortRebalance();
+    // Re-copies the dirty keys from their owner on ring to their owner on
+    // *next and clears them, reading them in batches with POST /export
+    // {"keys"}. Copied keys are appended to moved[old owner].
+    // Only the rebalancing thread changes ring, next and pools, so it may
+    // call this without mutex_; the final pass runs with it held exclusively.
+    bool catchUp(std::map<std::string, std::vector<std::string>>& moved,
+                 std::string& error);
+    // Unpaused catch-up passes until few enough dirty keys are left that the
+    // final pass only holds writes briefly; fails if writes keep too many
+    // keys dirty for that.
+    bool converge(std::map<std::string, std::vector<std::string>>& moved,
+                  std::string& error);
+
+    // Streams `from`'s keys in `ranges` (HashRing::rangesFor; empty = all
+    // keys) and imports every key whose owner on `target` is some other
+    // node. Moved keys are appended to `moved`.
+    bool migrate(const std::string& from, const HashRing& target,
+                 const std::vector<std::pair<std::uint64_t, std::uint64_t>>& ranges,
+                 std::vector<std::string>& moved, std::string& error);
+    bool deleteKeys(const std::shared_ptr<NodePool>& pool, const std::vector<std::string>& keys,
+                    std::string& error);
+};
@@ -1,6 +1,14 @@
 #pragma once
+#include <string>
+#include "admission.h"
 
 class KeyValueStore;
 class Persistence;
 
-void startServer(KeyValueStore &store, Persistence &wal);
\ No newline at end of file
+struct ServerConfig {
+    std::string host = "0.0.0.0";
+    int port = 8080;
+    AdmissionConfig admission;
+};
+
+void startServer(KeyValueStore &store, Persistence &wal, const ServerConfig &config = ServerConfig());
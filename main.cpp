@@ -2,37 +2,108 @@
 #include <filesystem>
 #include <thread>
 #include <chrono>
+#include <sstream>
+#include <vector>
+#include <string>
 
 #include "include/kvstore.h"
-#include "include/lru_cache.h"
 #include "include/persistence.h"
 #include "include/server.h"
+#include "include/router.h"
 
 namespace fs = std::filesystem;
 
-int main() {
-    fs::create_directories("data");
+static void usage() {
+    std::cerr <<
+        "usage: algovault [--port N] [--data DIR] [--capacity N]\n"
+        "                 [--workers N] [--queue-depth N] [--target-delay-ms N]\n"
+        "                 [--interval-ms N] [--write-slots N] [--write-wait-ms N]\n"
+        "                 [--keep-alive-sec N]\n"
+        "       algovault --router --nodes host:port[,host:port...] [--port N] [--vnodes N]\n";
+}
+
+static std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    ServerConfig config;
+    std::string dataDir = "data";
+    size_t capacity = 3;   // cap=3 for testing; increase in production
+    bool routerMode = false;
+    std::vector<std::string> nodes;
+    size_t vnodes = 160;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("missing value for " + a);
+                return argv[++i];
+            };
+
+            if (a == "--port") config.port = std::stoi(next());
+            else if (a == "--data") dataDir = next();
+            else if (a == "--capacity") capacity = std::stoul(next());
+            else if (a == "--workers") config.admission.workers = std::stoul(next());
+            else if (a == "--queue-depth") config.admission.queueDepth = std::stoul(next());
+            else if (a == "--target-delay-ms") config.admission.targetDelayMs = std::stoll(next());
+            else if (a == "--interval-ms") config.admission.intervalMs = std::stoll(next());
+            else if (a == "--write-slots") config.admission.writeSlots = std::stoul(next());
+            else if (a == "--write-wait-ms") config.admission.writeWaitMs = std::stoll(next());
+            else if (a == "--keep-alive-sec") config.admission.keepAliveSec = std::stoll(next());
+            else if (a == "--router") routerMode = true;
+            else if (a == "--nodes") nodes = splitList(next());
+            else if (a == "--vnodes") vnodes = std::stoul(next());
+            else { usage(); return a == "--help" || a == "-h" ? 0 : 2; }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << "\n";
+        usage();
+        return 2;
+    }
+
+    // ---------------------------
+    // 🔀 ROUTER MODE
+    // ---------------------------
+    if (routerMode) {
+        if (nodes.empty()) {
+            std::cerr << "--router needs at least one node in --nodes\n";
+            return 2;
+        }
+        ClusterRouter router(nodes, vnodes);
+        router.start(config);
+        return 0;
+    }
 
-    // Create cache (cap=3 for testing; increase in production)
-    LRUCache cache(3);
+    fs::create_directories(dataDir);
 
-    // Create KeyValueStore with cache
-    KeyValueStore store(&cache);
+    // Create KeyValueStore with LRU capacity
+    KeyValueStore store(capacity);
 
     // Setup WAL
-    Persistence wal("data/wal.log");
+    Persistence wal((fs::path(dataDir) / "wal.log").string());
     store.setPersistence(&wal);
 
     // Replay WAL → recover previous state
     wal.replay(
-        [&](const std::string& key, const std::string& value) { 
-            store.put(key, value, /*persist=*/false); 
+        [&](const std::string& key, const std::string& value, std::uint64_t version) { 
+            store.restore(key, value, version); 
         },
-        [&](const std::string& key) { 
-            store.del(key, /*persist=*/false); 
+        [&](const std::string& key, std::uint64_t version) { 
+            store.restoreDelete(key, version); 
         }
     );
 
+    store.finishRestore();
+    store.advanceVersion(wal.replayedVersion());
+
     std::cout << "Recovered " << store.size() << " keys from WAL.\n";
 
     // ---------------------------
@@ -50,7 +121,7 @@ int main() {
     // ---------------------------
     // 🌐 START REST API SERVER
     // ---------------------------
-    startServer(store, wal);
+    startServer(store, wal, config);
 
     return 0;
 }
@@ -0,0 +1,356 @@
+#include "admission.h"
+#include "httplib.h"
+#include "json.hpp"
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+enum class ShedReason { None, QueueDelay };
+
+// Set by the worker for the connection it is serving.
+thread_local ShedReason tlsShed = ShedReason::None;
+thread_local AdmissionController* tlsSlotOwner = nullptr;
+
+// Set on the accept thread while it answers a connection itself.
+thread_local bool tlsShedOnAccept = false;
+
+} // namespace
+
+// ------------------------------------------------------------
+//                     ADMISSION QUEUE
+// ------------------------------------------------------------
+
+// httplib::TaskQueue with a bounded FIFO of connections. A connection that
+// arrives while the queue is full is run right away on the accept thread,
+// where AdmissionServer answers it with a canned 503 instead of serving it.
+class AdmissionQueue final : public httplib::TaskQueue {
+public:
+    AdmissionQueue(AdmissionController& ctl, size_t workers, size_t depth)
+        : ctl(ctl), depth(depth) {
+        for (size_t i = 0; i < workers; ++i) {
+            threads.emplace_back([this] { work(); });
+        }
+    }
+
+    bool enqueue(std::function<void()> fn) override {
+        bool full;
+        {
+            std::lock_guard<std::mutex> lg(mutex_);
+            full = jobs.size() >= depth;
+            if (!full) {
+                jobs.push_back({ std::move(fn), AdmissionController::Clock::now() });
+                size_t len = jobs.size();
+                ctl.queueLength.store(len, std::memory_order_relaxed);
+                if (len > ctl.queuePeak.load(std::memory_order_relaxed)) {
+                    ctl.queuePeak.store(len, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        if (full) {
+            tlsShedOnAccept = true;
+            fn();   // AdmissionServer writes the 503 and closes the socket
+            tlsShedOnAccept = false;
+            return true;
+        }
+        ctl.queued.fetch_add(1, std::memory_order_relaxed);
+        cond.notify_one();
+        return true;
+    }
+
+    void shutdown() override {
+        {
+            std::lock_guard<std::mutex> lg(mutex_);
+            stopping = true;
+        }
+        cond.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+private:
+    struct Job {
+        std::function<void()> fn;
+        AdmissionController::Clock::time_point enqueuedAt;
+    };
+
+    AdmissionController& ctl;
+    size_t depth;
+
+    std::mutex mutex_;
+    std::condition_variable cond;
+    std::deque<Job> jobs;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+
+    void work() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond.wait(lock, [&] { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty()) return;
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                ctl.queueLength.store(jobs.size(), std::memory_order_relaxed);
+            }
+
+            if (ctl.onDequeue(AdmissionController::Clock::now() - job.enqueuedAt)) {
+                tlsShed = ShedReason::QueueDelay;
+            }
+
+            job.fn();
+
+            tlsShed = ShedReason::None;
+            ctl.releaseSlot();
+        }
+    }
+};
+
+// ------------------------------------------------------------
+//                     ADMISSION SERVER
+// ------------------------------------------------------------
+
+// Connections reach process_and_close_socket() through the task queue. On
+// the accept thread (queue full) the socket gets a canned 503 without its
+// request being read; otherwise it is served exactly like
+// httplib::Server::process_and_close_socket, which is private there.
+class AdmissionServer final : public httplib::Server {
+public:
+    explicit AdmissionServer(AdmissionController& ctl) : ctl(ctl) {
+        new_task_queue = [this] {
+            return new AdmissionQueue(this->ctl, this->ctl.cfg.workers, this->ctl.cfg.queueDepth);
+        };
+        set_keep_alive_timeout(static_cast<time_t>(ctl.cfg.keepAliveSec));
+    }
+
+    ~AdmissionServer() override {
+        std::lock_guard<std::mutex> lg(lingerMutex);
+        while (!lingering.empty()) closeLingering();
+    }
+
+private:
+    using Clock = AdmissionController::Clock;
+
+    // A shed socket stays half-open this long, so the request the client
+    // sends after connecting lands in our receive buffer instead of hitting
+    // a closed socket: the client can then read its 503 rather than seeing
+    // a reset (or dying of SIGPIPE).
+    static constexpr std::chrono::milliseconds kLinger{500};
+    static constexpr size_t kMaxLingering = 1024;
+
+    AdmissionController& ctl;
+
+    std::mutex lingerMutex;
+    std::deque<std::pair<socket_t, Clock::time_point>> lingering;
+
+    bool process_and_close_socket(socket_t sock) override {
+        reapLingering();
+        if (tlsShedOnAccept) {
+            shed(sock);
+            return false;
+        }
+
+        std::string remote_addr;
+        int remote_port = 0;
+        httplib::detail::get_remote_ip_and_port(sock, remote_addr, remote_port);
+
+        std::string local_addr;
+        int local_port = 0;
+        httplib::detail::get_local_ip_and_port(sock, local_addr, local_port);
+
+        auto ret = httplib::detail::process_server_socket(
+            svr_sock_, sock, keep_alive_max_count_, keep_alive_timeout_sec_,
+            read_timeout_sec_, read_timeout_usec_, write_timeout_sec_, write_timeout_usec_,
+            [&](httplib::Stream &strm, bool close_connection, bool &connection_closed) {
+                return process_request(strm, remote_addr, remote_port, local_addr, local_port,
+                                       close_connection, connection_closed, nullptr);
+            });
+
+        httplib::detail::shutdown_socket(sock);
+        httplib::detail::close_socket(sock);
+        return ret;
+    }
+
+    // Never blocks the accept thread: a fresh socket's send buffer takes the
+    // whole response, and the close itself is deferred (see kLinger).
+    void shed(socket_t sock) {
+        ctl.shedQueueFull.fetch_add(1, std::memory_order_relaxed);
+
+        std::string resp = ctl.cannedReject("queue full");
+        ssize_t sent = ::send(sock, resp.data(), resp.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent != static_cast<ssize_t>(resp.size())) {
+            ctl.rejected.fetch_add(1, std::memory_order_relaxed);
+        }
+        ::shutdown(sock, SHUT_WR);
+
+        std::lock_guard<std::mutex> lg(lingerMutex);
+        if (lingering.size() >= kMaxLingering) closeLingering();
+        lingering.emplace_back(sock, Clock::now() + kLinger);
+    }
+
+    void reapLingering() {
+        std::lock_guard<std::mutex> lg(lingerMutex);
+        auto now = Clock::now();
+        while (!lingering.empty() && lingering.front().second <= now) closeLingering();
+    }
+
+    // Drains what the client sent, so closing does not answer it with a
+    // reset that could discard the 503 before the client has read it.
+    void closeLingering() {
+        socket_t sock = lingering.front().first;
+        lingering.pop_front();
+        char drain[4096];
+        while (::recv(sock, drain, sizeof(drain), MSG_DONTWAIT) > 0) {}
+        httplib::detail::close_socket(sock);
+    }
+};
+
+// ------------------------------------------------------------
+//                   ADMISSION CONTROLLER
+// ------------------------------------------------------------
+
+AdmissionController::AdmissionController(const AdmissionConfig& config) : cfg(config) {
+    if (cfg.workers == 0) {
+        cfg.workers = std::max<size_t>(8, std::thread::hardware_concurrency() > 0
+                                              ? std::thread::hardware_concurrency() - 1 : 0);
+    }
+    if (cfg.queueDepth == 0) cfg.queueDepth = 1;
+    if (cfg.writeSlots == 0) cfg.writeSlots = std::max<size_t>(1, cfg.workers / 2);
+    cfg.writeSlots = std::min(cfg.writeSlots, cfg.workers);
+    if (cfg.intervalMs < cfg.targetDelayMs) cfg.intervalMs = cfg.targetDelayMs;
+    if (cfg.retryAfterSec < 1) cfg.retryAfterSec = 1;
+    if (cfg.keepAliveSec < 1) cfg.keepAliveSec = 1;
+}
+
+std::unique_ptr<httplib::Server> AdmissionController::makeServer() {
+    return std::make_unique<AdmissionServer>(*this);
+}
+
+// ---------------- CODEL ----------------
+bool AdmissionController::onDequeue(Clock::duration delay) {
+    auto now = Clock::now();
+    auto target = std::chrono::milliseconds(cfg.targetDelayMs);
+    auto interval = std::chrono::milliseconds(cfg.intervalMs);
+
+    std::lock_guard<std::mutex> lg(codelMutex);
+    lastDelay = delay;
+
+    // At the end of each interval: if even the best-served connection
+    // waited longer than target, the queue is standing, not bursting.
+    if (now >= windowEnd) {
+        if (windowEnd != Clock::time_point{}) overloaded = windowMinDelay > target;
+        windowEnd = now + interval;
+        windowMinDelay = delay;
+    } else {
+        windowMinDelay = std::min(windowMinDelay, delay);
+    }
+
+    auto cutoff = overloaded ? Clock::duration(target) : Clock::duration(interval);
+    return delay > cutoff;
+}
+
+// ---------------- PER REQUEST ----------------
+bool AdmissionController::isWrite(const httplib::Request& req) const {
+    if (req.method == "DELETE") return true;
+    if (req.method != "POST") return false;
+    return req.path == "/put" || req.path == "/import" || req.path == "/mdel" ||
+           req.path == "/compact";
+}
+
+long long AdmissionController::retryAfter() const {
+    std::lock_guard<std::mutex> lg(codelMutex);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(lastDelay).count();
+    return std::max<long long>(cfg.retryAfterSec, (ms + 999) / 1000);
+}
+
+void AdmissionController::reject(httplib::Response& res, const char* reason) {
+    long long retry = retryAfter();
+    res.status = 503;
+    res.set_header("Retry-After", std::to_string(retry));
+    json body = { {"error", "Server overloaded"}, {"reason", reason}, {"retry_after", retry} };
+    res.set_content(body.dump(), "application/json");
+}
+
+std::string AdmissionController::cannedReject(const char* reason) const {
+    long long retry = retryAfter();
+    json body = { {"error", "Server overloaded"}, {"reason", reason}, {"retry_after", retry} };
+    std::string content = body.dump();
+    return "HTTP/1.1 503 Service Unavailable\r\n"
+           "Content-Type: application/json\r\n"
+           "Retry-After: " + std::to_string(retry) + "\r\n"
+           "Connection: close\r\n"
+           "Content-Length: " + std::to_string(content.size()) + "\r\n\r\n" + content;
+}
+
+bool AdmissionController::admit(const httplib::Request& req, httplib::Response& res) {
+    releaseSlot();   // previous request on this keep-alive connection
+
+    if (tlsShed == ShedReason::QueueDelay) {
+        shedQueueDelay.fetch_add(1, std::memory_order_relaxed);
+        reject(res, "queue delay");
+        return false;
+    }
+
+    if (isWrite(req)) {
+        std::unique_lock<std::mutex> lock(slotMutex);
+        bool got = slotFreed.wait_for(lock, std::chrono::milliseconds(cfg.writeWaitMs),
+                                      [&] { return writesInFlight < cfg.writeSlots; });
+        if (!got) {
+            lock.unlock();
+            shedWrites.fetch_add(1, std::memory_order_relaxed);
+            reject(res, "write slots busy");
+            return false;
+        }
+        writesInFlight++;
+        tlsSlotOwner = this;
+    }
+
+    admitted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void AdmissionController::release(httplib::Response& res) {
+    releaseSlot();
+    if (queueLength.load(std::memory_order_relaxed) > 0) res.set_header("Connection", "close");
+}
+
+void AdmissionController::releaseSlot() {
+    if (tlsSlotOwner != this) return;
+    tlsSlotOwner = nullptr;
+    {
+        std::lock_guard<std::mutex> lg(slotMutex);
+        writesInFlight--;
+    }
+    slotFreed.notify_one();
+}
+
+AdmissionController::Stats AdmissionController::stats() const {
+    Stats s;
+    s.admitted = admitted.load(std::memory_order_relaxed);
+    s.queued = queued.load(std::memory_order_relaxed);
+    s.shedQueueDelay = shedQueueDelay.load(std::memory_order_relaxed);
+    s.shedQueueFull = shedQueueFull.load(std::memory_order_relaxed);
+    s.shedWrites = shedWrites.load(std::memory_order_relaxed);
+    s.rejected = rejected.load(std::memory_order_relaxed);
+    s.queueLength = queueLength.load(std::memory_order_relaxed);
+    s.queuePeak = queuePeak.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lg(codelMutex);
+        s.overloaded = overloaded;
+        s.queueDelayMs = std::chrono::duration<double, std::milli>(lastDelay).count();
+    }
+    {
+        std::lock_guard<std::mutex> lg(slotMutex);
+        s.writesInFlight = writesInFlight;
+    }
+    s.workers = cfg.workers;
+    s.queueDepth = cfg.queueDepth;
+    s.writeSlots = cfg.writeSlots;
+    return s;
+}
@@ -0,0 +1,178 @@
+#include "bulk_io.h"
+#include "json.hpp"
+#include <algorithm>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t kBinaryHeader = 4 + 4 + 8 + 8;
+
+void putLE(std::string& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>(v & 0xff));
+        v >>= 8;
+    }
+}
+
+// Keys and values end up in JSON (WAL, NDJSON export, /get), which only
+// carries UTF-8; binary imports are held to the same rule.
+bool validUtf8(const std::string& s) {
+    const auto* p = reinterpret_cast<const unsigned char*>(s.data());
+    const auto* end = p + s.size();
+    while (p < end) {
+        unsigned char c = *p;
+        size_t n;
+        uint32_t cp;
+        if (c < 0x80) { ++p; continue; }
+        else if ((c & 0xE0) == 0xC0) { n = 1; cp = c & 0x1F; }
+        else if ((c & 0xF0) == 0xE0) { n = 2; cp = c & 0x0F; }
+        else if ((c & 0xF8) == 0xF0) { n = 3; cp = c & 0x07; }
+        else return false;
+
+        if (static_cast<size_t>(end - p) <= n) return false;
+        for (size_t i = 1; i <= n; ++i) {
+            if ((p[i] & 0xC0) != 0x80) return false;
+            cp = (cp << 6) | (p[i] & 0x3F);
+        }
+        static const uint32_t kMin[] = { 0, 0x80, 0x800, 0x10000 };
+        if (cp < kMin[n] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return false;
+        p += n + 1;
+    }
+    return true;
+}
+
+uint64_t getLE(const char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        v = (v << 8) | static_cast<unsigned char>(p[i]);
+    }
+    return v;
+}
+
+} // namespace
+
+// ---------------- FORMAT ----------------
+BulkFormat bulkFormatFromContentType(const std::string& contentType) {
+    if (contentType.find("octet-stream") != std::string::npos) return BulkFormat::Binary;
+    return BulkFormat::NDJSON;
+}
+
+const char* bulkContentType(BulkFormat format) {
+    return format == BulkFormat::Binary ? "application/octet-stream" : "application/x-ndjson";
+}
+
+// ---------------- DECODER ----------------
+BulkDecoder::BulkDecoder(BulkFormat format, RecordCallback cb)
+    : format(format), onRecord(std::move(cb)) {}
+
+bool BulkDecoder::feed(const char* data, size_t len) {
+    if (!err.empty()) return false;
+    pending.append(data, len);
+    return format == BulkFormat::Binary ? drainBinary() : drainNdjson(false);
+}
+
+bool BulkDecoder::finish() {
+    if (!err.empty()) return false;
+    if (format == BulkFormat::NDJSON) return drainNdjson(true);
+
+    if (!pending.empty()) {
+        err = "truncated binary record (" + std::to_string(pending.size()) + " trailing bytes)";
+        return false;
+    }
+    return true;
+}
+
+bool BulkDecoder::parseLine(const std::string& text) {
+    ++line;
+    if (text.empty() || text == "\r") return true;
+
+    try {
+        json j = json::parse(text);
+        BulkRecord r;
+        r.key = j.at("key").get<std::string>();
+        r.value = j.at("value").get<std::string>();
+        if (j.contains("ttl")) r.ttl = j["ttl"].get<long long>();
+        if (j.contains("ver")) r.version = j["ver"].get<std::uint64_t>();
+        onRecord(std::move(r));
+        return true;
+    } catch (const std::exception& ex) {
+        err = "line " + std::to_string(line) + ": " + ex.what();
+        return false;
+    }
+}
+
+bool BulkDecoder::drainNdjson(bool final) {
+    // Resume the newline search where the previous feed() stopped, so a
+    // long record arriving in small chunks is scanned once, not per chunk.
+    size_t start = 0;
+    size_t nl;
+    while ((nl = pending.find('\n', std::max(start, scanned))) != std::string::npos) {
+        if (!parseLine(pending.substr(start, nl - start))) return false;
+        start = nl + 1;
+    }
+    pending.erase(0, start);
+    scanned = pending.size();
+
+    // JSON escaping can at most sextuple a string (\u00XX)
+    if (pending.size() > 6 * (kMaxKeyBytes + kMaxValueBytes) + 1024) {
+        err = "line " + std::to_string(line + 1) + ": record too large";
+        return false;
+    }
+
+    if (final && !pending.empty()) {
+        std::string last;
+        last.swap(pending);
+        return parseLine(last);
+    }
+    return true;
+}
+
+bool BulkDecoder::drainBinary() {
+    size_t pos = 0;
+    while (pending.size() - pos >= kBinaryHeader) {
+        const char* p = pending.data() + pos;
+        uint64_t keyLen = getLE(p, 4);
+        uint64_t valueLen = getLE(p + 4, 4);
+        if (keyLen > kMaxKeyBytes || valueLen > kMaxValueBytes) {
+            err = "binary record too large (key " + std::to_string(keyLen) +
+                  " bytes, value " + std::to_string(valueLen) + " bytes)";
+            return false;
+        }
+        if (pending.size() - pos < kBinaryHeader + keyLen + valueLen) break;
+
+        BulkRecord r;
+        r.ttl = static_cast<long long>(getLE(p + 8, 8));
+        r.version = getLE(p + 16, 8);
+        r.key.assign(p + kBinaryHeader, keyLen);
+        r.value.assign(p + kBinaryHeader + keyLen, valueLen);
+        if (!validUtf8(r.key) || !validUtf8(r.value)) {
+            err = "binary record with key/value that is not valid UTF-8";
+            return false;
+        }
+        onRecord(std::move(r));
+
+        pos += kBinaryHeader + keyLen + valueLen;
+    }
+    pending.erase(0, pos);
+    return true;
+}
+
+// ---------------- ENCODER ----------------
+void encodeBulkRecord(BulkFormat format, const BulkRecord& r, std::string& out) {
+    if (format == BulkFormat::Binary) {
+        putLE(out, r.key.size(), 4);
+        putLE(out, r.value.size(), 4);
+        putLE(out, static_cast<uint64_t>(r.ttl), 8);
+        putLE(out, r.version, 8);
+        out += r.key;
+        out += r.value;
+        return;
+    }
+
+    json j = { {"key", r.key}, {"value", r.value} };
+    if (r.ttl >= 0) j["ttl"] = r.ttl;
+    if (r.version) j["ver"] = r.version;
+    out += j.dump();
+    out.push_back('\n');
+}
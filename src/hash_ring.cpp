@@ -0,0 +1,74 @@
+#include "hash_ring.h"
+#include <algorithm>
+
+namespace {
+const std::string kNoNode;
+}
+
+HashRing::HashRing(size_t vnodes) : vnodeCount(vnodes == 0 ? 1 : vnodes) {}
+
+// FNV-1a followed by the murmur3 finalizer: FNV alone clusters badly on
+// short, similar strings like "node#1", "node#2".
+std::uint64_t HashRing::hash(const std::string& s) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void HashRing::addNode(const std::string& node) {
+    if (hasNode(node)) return;
+    members.push_back(node);
+    for (size_t i = 0; i < vnodeCount; ++i) {
+        // on the (unlikely) collision the earlier node keeps the point
+        ring.emplace(hash(node + "#" + std::to_string(i)), node);
+    }
+}
+
+void HashRing::removeNode(const std::string& node) {
+    auto m = std::find(members.begin(), members.end(), node);
+    if (m == members.end()) return;
+    members.erase(m);
+
+    for (auto it = ring.begin(); it != ring.end();) {
+        if (it->second == node) it = ring.erase(it);
+        else ++it;
+    }
+}
+
+bool HashRing::hasNode(const std::string& node) const {
+    return std::find(members.begin(), members.end(), node) != members.end();
+}
+
+std::vector<std::pair<std::uint64_t, std::uint64_t>> HashRing::rangesFor(const std::string& node) const {
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> out;
+    std::uint64_t lo = 0;   // just past the previous point
+    for (const auto& p : ring) {
+        if (p.second == node) {
+            if (!out.empty() && out.back().second + 1 == lo) out.back().second = p.first;
+            else out.emplace_back(lo, p.first);
+        }
+        lo = p.first + 1;
+    }
+
+    // hashes past the last point wrap around to the first one
+    if (!ring.empty() && ring.begin()->second == node && lo != 0) {
+        if (!out.empty() && out.back().second + 1 == lo) out.back().second = UINT64_MAX;
+        else out.emplace_back(lo, UINT64_MAX);
+    }
+    return out;
+}
+
+const std::string& HashRing::nodeFor(const std::string& key) const {
+    if (ring.empty()) return kNoNode;
+    auto it = ring.lower_bound(hash(key));
+    if (it == ring.end()) it = ring.begin();
+    return it->second;
+}
@@ -1,122 +1,462 @@
 #include "kvstore.h"
 #include "persistence.h"
-#include "lru_cache.h"
 #include <iostream>
+#include <algorithm>
+#include <stdexcept>
 
-KeyValueStore::KeyValueStore(LRUCache* cachePtr)
-    : persistence(nullptr), cache(cachePtr) 
-{
-    if (cache) {
-        cache->setEvictionCallback([this](const std::string& k) {
-            this->onCacheEvict(k);
-        });
+#ifdef ALGOVAULT_OP_COUNTERS
+    #define COUNT_LOCK()  KeyValueStore::opCounters().locks.fetch_add(1, std::memory_order_relaxed)
+    #define COUNT_PROBE() KeyValueStore::opCounters().probes.fetch_add(1, std::memory_order_relaxed)
+
+KeyValueStore::OpCounters& KeyValueStore::opCounters() {
+    static OpCounters counters;
+    return counters;
+}
+#else
+    #define COUNT_LOCK()  ((void)0)
+    #define COUNT_PROBE() ((void)0)
+#endif
+
+KeyValueStore::KeyValueStore(size_t capacity)
+    : maxEntries(capacity) {}
+
+// ---------------- LOCKED HELPERS ----------------
+KeyValueStore::Entry& KeyValueStore::upsertLocked(const std::string& key, const std::string& value,
+                                                  std::uint64_t version) {
+    COUNT_PROBE();
+    if (version == 0) checkVersionLocked();
+    auto [it, inserted] = entries.try_emplace(key);
+    Entry& e = linkLocked(it, inserted);
+
+    e.value = value;
+    if (version == 0) {
+        e.version = ++lastVersion;
+    } else {
+        e.version = version;
+        if (version > lastVersion) lastVersion = version;
+    }
+    return e;
+}
+
+KeyValueStore::Entry& KeyValueStore::linkLocked(std::unordered_map<std::string, Entry>::iterator it,
+                                                bool inserted) {
+    Entry& e = it->second;
+    if (inserted) {
+        recency.push_front(&it->first);
+        e.lru = recency.begin();
+    } else {
+        preserveLocked(it->first, e);
+        recency.splice(recency.begin(), recency, e.lru);
+        // overwriting a lapsed key starts it fresh, without the old TTL
+        if (expiredAt(e, nowMs())) e.expiresAt = 0;
+    }
+    return e;
+}
+
+void KeyValueStore::eraseLocked(std::unordered_map<std::string, Entry>::iterator it) {
+    preserveLocked(it->first, it->second);
+    recency.erase(it->second.lru);
+    entries.erase(it);
+}
+
+void KeyValueStore::checkVersionLocked() const {
+    // wrapping would hand out versions (and ETags) that already exist
+    if (lastVersion >= MAX_VERSION) throw std::overflow_error("version counter exhausted");
+}
+
+void KeyValueStore::preserveLocked(const std::string& key, const Entry& e) {
+    for (Walk* w : walks) {
+        if (e.version > w->since || w->preImages.count(key)) continue;
+        if (*w->filter && !(*w->filter)(key)) continue;
+        w->preImages.emplace(key, PreImage{ e.value, e.expiresAt, e.version });
+    }
+}
+
+void KeyValueStore::evictLocked(std::vector<std::string>& evicted) {
+    if (maxEntries == 0) return;
+
+    while (entries.size() > maxEntries) {
+        const std::string* victim = recency.back();
+        evicted.push_back(*victim);
+        COUNT_PROBE();
+        eraseLocked(entries.find(*victim));
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool KeyValueStore::versionMatches(const Entry* live, std::uint64_t expected) const {
+    if (expected == ANY_VERSION) return true;
+    if (expected == MUST_EXIST) return live != nullptr;
+    if (expected == MUST_NOT_EXIST) return live == nullptr;
+    if (expected == NO_MATCH) return false;
+    return live != nullptr && live->version == expected;
+}
+
+void KeyValueStore::logEvictions(const std::vector<std::string>& evicted) {
+    for (const auto& k : evicted) {
+        std::cout << "[LRU] Evicted key: " << k << std::endl;
     }
 }
 
 // ---------------- PUT ----------------
 bool KeyValueStore::put(const std::string& key, const std::string& value, bool persist) {
+    std::uint64_t version = 0;
+    return putIf(key, value, ANY_VERSION, version, persist);
+}
+
+bool KeyValueStore::putIf(const std::string& key, const std::string& value,
+                          std::uint64_t expected, std::uint64_t& version, bool persist) {
+    std::vector<std::string> evicted;
     {
         std::unique_lock lock(mutex_);
-        store[key] = value;
-    }
+        COUNT_LOCK();
+        COUNT_PROBE();
+        checkVersionLocked();
+        auto [it, inserted] = entries.try_emplace(key);
+        Entry* live = inserted || expiredAt(it->second, nowMs()) ? nullptr : &it->second;
+
+        if (!versionMatches(live, expected)) {
+            version = live ? live->version : 0;
+            if (inserted) entries.erase(it);
+            return false;
+        }
 
-    if (cache) cache->put(key, value);
+        Entry& e = linkLocked(it, inserted);
+        e.value = value;
+        e.version = ++lastVersion;
+        version = e.version;
+        evictLocked(evicted);
+    }
 
-    if (persist) onPut(key, value);
+    logEvictions(evicted);
+    if (persist) onPut(key, value, version);
     return true;
 }
 
 // ---------------- GET ----------------
 std::string KeyValueStore::get(const std::string& key, bool& found) {
+    std::uint64_t version = 0;
+    return get(key, found, version);
+}
 
-    // TTL check
-    if (isExpired(key)) {
-        found = false;
-        return "";
-    }
+std::string KeyValueStore::get(const std::string& key, bool& found, std::uint64_t& version) {
+    std::uint64_t delVersion;
+    {
+        std::unique_lock lock(mutex_);
+        COUNT_LOCK();
+        COUNT_PROBE();
+        auto it = entries.find(key);
+
+        if (it == entries.end()) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            found = false;
+            version = 0;
+            return "";
+        }
 
-    // Cache lookup
-    if (cache) {
-        std::string v;
-        if (cache->get(key, v)) {
+        if (!expiredAt(it->second, nowMs())) {
+            recency.splice(recency.begin(), recency, it->second.lru);
+            hits.fetch_add(1, std::memory_order_relaxed);
             found = true;
-            return v;
+            version = it->second.version;
+            return it->second.value;
         }
-    }
 
-    // Store lookup
-    std::shared_lock lock(mutex_);
-    auto it = store.find(key);
-
-    if (it != store.end()) {
-        found = true;
-        if (cache) cache->put(key, it->second);
-        return it->second;
+        // Lazy expiry: drop it while we already hold the lock.
+        checkVersionLocked();
+        eraseLocked(it);
+        delVersion = ++lastVersion;
+        misses.fetch_add(1, std::memory_order_relaxed);
     }
 
+    onDelete(key, delVersion);
     found = false;
+    version = 0;
     return "";
 }
 
 // ---------------- DELETE ----------------
 bool KeyValueStore::del(const std::string& key, bool persist) {
+    std::uint64_t version = 0;
+    return delIf(key, ANY_VERSION, version, persist);
+}
+
+bool KeyValueStore::delIf(const std::string& key, std::uint64_t expected,
+                          std::uint64_t& version, bool persist) {
+    bool deleted = false;
+    std::uint64_t delVersion = 0;
     {
         std::unique_lock lock(mutex_);
-        if (store.erase(key) == 0) return false;
-        expiry.erase(key);
+        COUNT_LOCK();
+        COUNT_PROBE();
+        checkVersionLocked();
+        auto it = entries.find(key);
+        Entry* live = nullptr;
+
+        if (it != entries.end()) {
+            if (expiredAt(it->second, nowMs())) {
+                // lapsed: drop it now, but it does not count as deleted
+                eraseLocked(it);
+                delVersion = ++lastVersion;
+            } else {
+                live = &it->second;
+            }
+        }
+
+        if (live && versionMatches(live, expected)) {
+            eraseLocked(it);
+            delVersion = ++lastVersion;
+            deleted = true;
+        }
+        version = deleted ? delVersion : (live ? live->version : 0);
     }
 
-    if (cache) cache->remove(key);
-    if (persist) onDelete(key);
-    return true;
+    if (delVersion && (persist || !deleted)) onDelete(key, delVersion);
+    return deleted;
 }
 
 // ---------------- EXISTS ----------------
 bool KeyValueStore::exists(const std::string& key) {
-    if (isExpired(key)) return false;
-
-    if (cache && cache->exists(key)) return true;
+    std::uint64_t delVersion;
+    {
+        std::unique_lock lock(mutex_);
+        COUNT_LOCK();
+        COUNT_PROBE();
+        auto it = entries.find(key);
+        if (it == entries.end()) return false;
+        if (!expiredAt(it->second, nowMs())) return true;
+        checkVersionLocked();
+        eraseLocked(it);
+        delVersion = ++lastVersion;
+    }
 
-    std::shared_lock lock(mutex_);
-    return store.find(key) != store.end();
+    onDelete(key, delVersion);
+    return false;
 }
 
 // ---------------- SIZE ----------------
 size_t KeyValueStore::size() {
     std::shared_lock lock(mutex_);
-    return store.size();
+    return entries.size();
+}
+
+// ---------------- VERSIONS ----------------
+void KeyValueStore::restore(const std::string& key, const std::string& value, std::uint64_t version) {
+    std::vector<std::string> evicted;
+    {
+        std::unique_lock lock(mutex_);
+        COUNT_LOCK();
+        if (version > MAX_VERSION) version = 0;
+        if (version != 0) {
+            if (version > lastVersion) lastVersion = version;
+
+            auto d = replayedDeletes.find(key);
+            if (d != replayedDeletes.end() && d->second > version) return;
+
+            auto it = entries.find(key);
+            if (it != entries.end() && it->second.version > version) return;
+        }
+        upsertLocked(key, value, version);
+        evictLocked(evicted);
+    }
+    logEvictions(evicted);
+}
+
+void KeyValueStore::restoreDelete(const std::string& key, std::uint64_t version) {
+    std::unique_lock lock(mutex_);
+    COUNT_LOCK();
+    auto it = entries.find(key);
+
+    if (version > MAX_VERSION) version = 0;
+    if (version != 0) {
+        if (version > lastVersion) lastVersion = version;
+        if (it != entries.end() && it->second.version > version) return;
+
+        auto& marker = replayedDeletes[key];
+        if (version > marker) marker = version;
+    }
+    if (it != entries.end()) eraseLocked(it);
+}
+
+void KeyValueStore::finishRestore() {
+    std::unique_lock lock(mutex_);
+    replayedDeletes.clear();
+    replayedDeletes.rehash(0);
+}
+
+void KeyValueStore::advanceVersion(std::uint64_t v) {
+    std::unique_lock lock(mutex_);
+    if (v > lastVersion) lastVersion = std::min(v, MAX_VERSION);
+}
+
+std::uint64_t KeyValueStore::currentVersion() {
+    std::shared_lock lock(mutex_);
+    return lastVersion;
 }
 
 // ---------------- SNAPSHOT ----------------
-std::unordered_map<std::string, std::string> KeyValueStore::snapshot() {
+std::vector<BulkRecord> KeyValueStore::snapshot() {
     std::shared_lock lock(mutex_);
-    return store;
+    long long now = nowMs();
+    std::vector<BulkRecord> out;
+    out.reserve(entries.size());
+    for (const auto& kv : entries) {
+        const Entry& e = kv.second;
+        if (expiredAt(e, now)) continue;
+        long long ttl = e.expiresAt != 0 ? (e.expiresAt - now + 999) / 1000 : -1;
+        out.push_back({ kv.first, e.value, ttl, e.version });
+    }
+    return out;
+}
+
+// ---------------- BULK LOAD ----------------
+size_t KeyValueStore::putBatch(std::vector<BulkRecord>& records) {
+    std::vector<std::string> evicted;
+    {
+        std::unique_lock lock(mutex_);
+        COUNT_LOCK();
+        long long now = nowMs();
+        for (auto& r : records) {
+            if (r.version > MAX_VERSION) r.version = 0;
+            if (r.version > lastVersion) lastVersion = r.version;
+        }
+        for (auto& r : records) {
+            auto it = entries.find(r.key);
+            bool newer = r.version != 0 && (it == entries.end() || it->second.version < r.version);
+            Entry& e = upsertLocked(r.key, r.value, newer ? r.version : 0);
+            e.expiresAt = r.ttl >= 0 ? now + r.ttl * 1000 : 0;
+            r.version = e.version;
+        }
+        evictLocked(evicted);
+    }
+
+    logEvictions(evicted);
+    return records.size();
+}
+
+// ---------------- BULK DUMP ----------------
+std::vector<BulkRecord> KeyValueStore::getRecords(const std::vector<std::string>& keys) {
+    std::vector<BulkRecord> out;
+    std::shared_lock lock(mutex_);
+    COUNT_LOCK();
+    long long now = nowMs();
+    for (const auto& key : keys) {
+        COUNT_PROBE();
+        auto it = entries.find(key);
+        if (it == entries.end() || expiredAt(it->second, now)) continue;
+        const Entry& e = it->second;
+        long long ttl = e.expiresAt != 0 ? (e.expiresAt - now + 999) / 1000 : -1;
+        out.push_back({ key, e.value, ttl, e.version });
+    }
+    return out;
+}
+
+void KeyValueStore::forEach(const std::function<bool(const BulkRecord&)>& fn, size_t chunk,
+                            const KeyFilter& filter) {
+    if (chunk == 0) chunk = 1;
+
+    // Writers only touch `walks` under the exclusive lock; concurrent walks
+    // registering under the shared one serialize on walksMutex.
+    Walk walk;
+    std::vector<std::string> keys;
+    {
+        std::shared_lock lock(mutex_);
+        std::lock_guard<std::mutex> lg(walksMutex);
+        walk.since = lastVersion;
+        walk.filter = &filter;
+        walks.push_back(&walk);
+        if (!filter) keys.reserve(entries.size());
+        for (const auto& kv : entries) {
+            if (!filter || filter(kv.first)) keys.push_back(kv.first);
+        }
+    }
+
+    struct Unregister {
+        KeyValueStore* self;
+        Walk* walk;
+        ~Unregister() {
+            std::unique_lock lock(self->mutex_);
+            self->walks.erase(std::find(self->walks.begin(), self->walks.end(), walk));
+        }
+    } unregister{ this, &walk };
+
+    std::vector<BulkRecord> batch;
+    batch.reserve(std::min(chunk, keys.size()));
+
+    for (size_t i = 0; i < keys.size(); i += chunk) {
+        batch.clear();
+        {
+            // The pre-image map is only written under the exclusive lock and
+            // only this walk reads it, so it can be trimmed here.
+            std::shared_lock lock(mutex_);
+            long long now = nowMs();
+            for (size_t j = i; j < std::min(i + chunk, keys.size()); ++j) {
+                std::string value;
+                long long expiresAt;
+                std::uint64_t version;
+
+                auto pre = walk.preImages.find(keys[j]);
+                if (pre != walk.preImages.end()) {
+                    value = std::move(pre->second.value);
+                    expiresAt = pre->second.expiresAt;
+                    version = pre->second.version;
+                    walk.preImages.erase(pre);
+                } else {
+                    auto it = entries.find(keys[j]);
+                    if (it == entries.end()) continue;
+                    value = it->second.value;
+                    expiresAt = it->second.expiresAt;
+                    version = it->second.version;
+                }
+
+                long long ttl = -1;
+                if (expiresAt != 0) {
+                    long long remaining = expiresAt - now;
+                    if (remaining <= 0) continue;
+                    ttl = (remaining + 999) / 1000;
+                }
+                batch.push_back({ keys[j], std::move(value), ttl, version });
+            }
+        }
+
+        // no lock held: fn may block (e.g. on a slow client socket)
+        for (const auto& r : batch) {
+            if (!fn(r)) return;
+        }
+    }
 }
 
 // ---------------- WAL PERSISTENCE HOOKS ----------------
 void KeyValueStore::setPersistence(Persistence* p) { persistence = p; }
 
-void KeyValueStore::attachCache(LRUCache* cachePtr) {
-    cache = cachePtr;
-    if (cache) {
-        cache->setEvictionCallback([this](const std::string& k) {
-            this->onCacheEvict(k);
-        });
-    }
+void KeyValueStore::onPut(const std::string& key, const std::string& value, std::uint64_t version) {
+    if (persistence) persistence->appendSet(key, value, version);
 }
 
-void KeyValueStore::onPut(const std::string& key, const std::string& value) {
-    if (persistence) persistence->appendSet(key, value);
+void KeyValueStore::onDelete(const std::string& key, std::uint64_t version) {
+    if (persistence) persistence->appendDel(key, version);
 }
 
-void KeyValueStore::onDelete(const std::string& key) {
-    if (persistence) persistence->appendDel(key);
+// ------------------------------------------------------------
+//                     LRU / CACHE STATS
+// ------------------------------------------------------------
+
+size_t KeyValueStore::capacity() const {
+    return maxEntries;
 }
 
-void KeyValueStore::onCacheEvict(const std::string& key) {
-    std::unique_lock lock(mutex_);
-    store.erase(key);
-    expiry.erase(key);
+KeyValueStore::CacheStats KeyValueStore::getCacheStats() const {
+    CacheStats s;
+    s.hits = hits.load(std::memory_order_relaxed);
+    s.misses = misses.load(std::memory_order_relaxed);
+    s.evictions = evictions.load(std::memory_order_relaxed);
+    return s;
+}
+
+void KeyValueStore::resetCacheStats() {
+    hits.store(0, std::memory_order_relaxed);
+    misses.store(0, std::memory_order_relaxed);
+    evictions.store(0, std::memory_order_relaxed);
 }
 
 // ------------------------------------------------------------
@@ -125,46 +465,61 @@ void KeyValueStore::onCacheEvict(const std::string& key) {
 
 void KeyValueStore::setTTL(const std::string& key, long long ttlSeconds) {
     std::unique_lock lock(mutex_);
-    expiry[key] = nowMs() + ttlSeconds * 1000;
+    COUNT_LOCK();
+    COUNT_PROBE();
+    auto it = entries.find(key);
+    if (it == entries.end()) return;
+    preserveLocked(it->first, it->second);
+    it->second.expiresAt = nowMs() + ttlSeconds * 1000;
 }
 
 long long KeyValueStore::getTTL(const std::string& key) {
     std::shared_lock lock(mutex_);
-    if (expiry.find(key) == expiry.end()) return -1;
+    COUNT_LOCK();
+    COUNT_PROBE();
+    auto it = entries.find(key);
+    if (it == entries.end() || it->second.expiresAt == 0) return -1;
 
-    long long remaining = expiry[key] - nowMs();
+    long long remaining = it->second.expiresAt - nowMs();
     return remaining > 0 ? remaining / 1000 : 0;
 }
 
 bool KeyValueStore::isExpired(const std::string& key) {
-    std::shared_lock lock(mutex_);
-    auto it = expiry.find(key);
-    if (it == expiry.end()) return false;
-
-    bool expired = nowMs() > it->second;
-    if (!expired) return false;
+    std::uint64_t delVersion;
+    {
+        std::unique_lock lock(mutex_);
+        COUNT_LOCK();
+        COUNT_PROBE();
+        auto it = entries.find(key);
+        if (it == entries.end() || !expiredAt(it->second, nowMs())) return false;
+        checkVersionLocked();
+        eraseLocked(it);
+        delVersion = ++lastVersion;
+    }
 
-    lock.unlock();
-    del(key, true);
+    onDelete(key, delVersion);
     return true;
 }
 
 void KeyValueStore::cleanupExpired() {
-    std::vector<std::string> expiredKeys;
+    std::vector<std::pair<std::string, std::uint64_t>> expiredKeys;
 
     {
-        std::shared_lock lock(mutex_);
-        for (auto &p : expiry) {
-            if (nowMs() > p.second) expiredKeys.push_back(p.first);
+        std::unique_lock lock(mutex_);
+        long long now = nowMs();
+        for (auto it = entries.begin(); it != entries.end() && lastVersion < MAX_VERSION;) {
+            if (expiredAt(it->second, now)) {
+                expiredKeys.emplace_back(it->first, ++lastVersion);
+                preserveLocked(it->first, it->second);
+                recency.erase(it->second.lru);
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
         }
     }
 
     for (auto &k : expiredKeys) {
-        del(k, true);
+        onDelete(k.first, k.second);
     }
 }
-
-// ---------------- GET CACHE POINTER ----------------
-LRUCache* KeyValueStore::getCache() const {
-    return cache;
-}
\ No newline at end of file
@@ -36,7 +36,7 @@ void Persistence::doFsync(std::ofstream& ofs) {
 #endif
 }
 
-bool Persistence::appendSet(const std::string& key, const std::string& value) {
+bool Persistence::appendSet(const std::string& key, const std::string& value, std::uint64_t version) {
     std::lock_guard<std::mutex> lg(fileMutex);
     try {
         std::ofstream ofs(filepath, std::ios::app);
@@ -49,6 +49,7 @@ bool Persistence::appendSet(const std::string& key, const std::string& value) {
         j["op"] = "SET";
         j["key"] = key;
         j["value"] = value;
+        if (version) j["ver"] = version;
         j["ts"] = std::chrono::duration_cast<std::chrono::milliseconds>(
                       std::chrono::system_clock::now().time_since_epoch())
                       .count();
@@ -64,7 +65,7 @@ bool Persistence::appendSet(const std::string& key, const std::string& value) {
     }
 }
 
-bool Persistence::appendDel(const std::string& key) {
+bool Persistence::appendDel(const std::string& key, std::uint64_t version) {
     std::lock_guard<std::mutex> lg(fileMutex);
     try {
         std::ofstream ofs(filepath, std::ios::app);
@@ -76,6 +77,7 @@ bool Persistence::appendDel(const std::string& key) {
         json j;
         j["op"] = "DEL";
         j["key"] = key;
+        if (version) j["ver"] = version;
         j["ts"] = std::chrono::duration_cast<std::chrono::milliseconds>(
                       std::chrono::system_clock::now().time_since_epoch())
                       .count();
@@ -91,9 +93,100 @@ bool Persistence::appendDel(const std::string& key) {
     }
 }
 
-bool Persistence::replay(const std::function<void(const std::string&, const std::string&)>& setCb,
-                         const std::function<void(const std::string&)>& delCb) {
+bool Persistence::appendSetBatch(const std::vector<BulkRecord>& records) {
+    if (records.empty()) return true;
+
+    std::lock_guard<std::mutex> lg(fileMutex);
+    try {
+        std::ofstream ofs(filepath, std::ios::app);
+        if (!ofs.is_open()) {
+            std::cerr << "[WAL] cannot open file for append: " << filepath << "\n";
+            return false;
+        }
+
+        long long ts = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+
+        std::string buf;
+        for (const auto& r : records) {
+            json j;
+            j["op"] = "SET";
+            j["key"] = r.key;
+            j["value"] = r.value;
+            if (r.version) j["ver"] = r.version;
+            j["ts"] = ts;
+            buf += j.dump();
+            buf.push_back('\n');
+        }
+
+        ofs.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        ofs.flush();
+        ofs.close();
+        return static_cast<bool>(ofs);
+    } catch (const std::exception& ex) {
+        std::cerr << "[WAL] appendSetBatch exception: " << ex.what() << "\n";
+        return false;
+    }
+}
+
+bool Persistence::appendDelBatch(const std::vector<std::pair<std::string, std::uint64_t>>& keys) {
+    if (keys.empty()) return true;
+
+    std::lock_guard<std::mutex> lg(fileMutex);
+    try {
+        std::ofstream ofs(filepath, std::ios::app);
+        if (!ofs.is_open()) {
+            std::cerr << "[WAL] cannot open file for append: " << filepath << "\n";
+            return false;
+        }
+
+        long long ts = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+
+        std::string buf;
+        for (const auto& kv : keys) {
+            json j;
+            j["op"] = "DEL";
+            j["key"] = kv.first;
+            if (kv.second) j["ver"] = kv.second;
+            j["ts"] = ts;
+            buf += j.dump();
+            buf.push_back('\n');
+        }
+
+        ofs.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        ofs.flush();
+        ofs.close();
+        return static_cast<bool>(ofs);
+    } catch (const std::exception& ex) {
+        std::cerr << "[WAL] appendDelBatch exception: " << ex.what() << "\n";
+        return false;
+    }
+}
+
+bool Persistence::sync() {
     std::lock_guard<std::mutex> lg(fileMutex);
+    try {
+        std::ofstream ofs(filepath, std::ios::app);
+        if (!ofs.is_open()) {
+            std::cerr << "[WAL] sync: cannot open file: " << filepath << "\n";
+            return false;
+        }
+        doFsync(ofs);
+        ofs.close();
+        return true;
+    } catch (const std::exception& ex) {
+        std::cerr << "[WAL] sync exception: " << ex.what() << "\n";
+        return false;
+    }
+}
+
+bool Persistence::replay(const std::function<void(const std::string&, const std::string&, std::uint64_t)>& setCb,
+                         const std::function<void(const std::string&, std::uint64_t)>& delCb) {
+    std::lock_guard<std::mutex> lg(fileMutex);
+    maxReplayedVersion = 0;
     try {
         std::ifstream ifs(filepath);
         if (!ifs.is_open()) {
@@ -107,13 +200,18 @@ bool Persistence::replay(const std::function<void(const std::string&, const std:
             try {
                 json j = json::parse(line);
                 std::string op = j.value("op", "");
+                std::uint64_t ver = j.value("ver", std::uint64_t{0});
+                if (ver > maxReplayedVersion) maxReplayedVersion = ver;
+
                 if (op == "SET") {
                     std::string key = j.value("key", "");
                     std::string value = j.value("value", "");
-                    setCb(key, value);
+                    setCb(key, value, ver);
                 } else if (op == "DEL") {
                     std::string key = j.value("key", "");
-                    delCb(key);
+                    delCb(key, ver);
+                } else if (op == "VER") {
+                    // version high-water mark written by compact()
                 } else {
                     // unknown op — ignore
                 }
@@ -129,7 +227,11 @@ bool Persistence::replay(const std::function<void(const std::string&, const std:
     }
 }
 
-bool Persistence::compact(const std::unordered_map<std::string, std::string>& snapshot) {
+std::uint64_t Persistence::replayedVersion() const {
+    return maxReplayedVersion;
+}
+
+bool Persistence::compact(const std::vector<BulkRecord>& snapshot, std::uint64_t highVersion) {
     std::lock_guard<std::mutex> lg(fileMutex);
     std::string tmpPath = filepath + ".tmp";
 
@@ -141,14 +243,23 @@ bool Persistence::compact(const std::unordered_map<std::string, std::string>& sn
             return false;
         }
 
-        for (const auto& kv : snapshot) {
+        long long ts = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+
+        json ver;
+        ver["op"] = "VER";
+        ver["ver"] = highVersion;
+        ver["ts"] = ts;
+        ofs << ver.dump() << "\n";
+
+        for (const auto& r : snapshot) {
             json j;
             j["op"] = "SET";
-            j["key"] = kv.first;
-            j["value"] = kv.second;
-            j["ts"] = std::chrono::duration_cast<std::chrono::milliseconds>(
-                          std::chrono::system_clock::now().time_since_epoch())
-                          .count();
+            j["key"] = r.key;
+            j["value"] = r.value;
+            if (r.version) j["ver"] = r.version;
+            j["ts"] = ts;
             ofs << j.dump() << "\n";
         }
         ofs.flush();
@@ -0,0 +1,632 @@
+#include "router.h"
+#include "bulk_io.h"
+#include "json.hpp"
+#include "httplib.h"
+#include <iostream>
+#include <future>
+#include <algorithm>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t kImportFlushBytes = 1 << 20;   // per-target /import body size
+constexpr size_t kDeleteBatch = 5000;           // keys per /mdel on the old owner
+constexpr size_t kCatchUpFinalKeys = 64;        // dirty keys left for the paused pass
+constexpr size_t kCatchUpMaxFinalKeys = 4096;   // more than this after the passes: abort
+constexpr int kCatchUpPasses = 8;               // unpaused passes before giving up on that
+constexpr size_t kCatchUpReadBatch = 5000;      // dirty keys per POST /export {"keys"}
+constexpr time_t kTimeoutSec = 30;              // node read/write timeout
+constexpr time_t kRebalanceTimeoutSec = 2;      // ... for calls that can hold the ring switch
+
+void setTimeouts(httplib::Client &cli, time_t sec) {
+    cli.set_read_timeout(sec, 0);
+    cli.set_write_timeout(sec, 0);
+}
+
+// conditional-request headers the nodes understand
+httplib::Headers forwardHeaders(const httplib::Request &req) {
+    httplib::Headers h;
+    for (const char *name : { "If-Match", "If-None-Match" }) {
+        if (req.has_header(name)) h.emplace(name, req.get_header_value(name));
+    }
+    return h;
+}
+
+void nodeUnavailable(httplib::Response &res, const std::string &node) {
+    res.status = 502;
+    json resp = { {"error", "node unavailable"}, {"node", node} };
+    res.set_content(resp.dump(), "application/json");
+}
+
+// Copies a node's answer into the router's response.
+void relay(const httplib::Result &r, const std::string &node, httplib::Response &res) {
+    if (!r) {
+        nodeUnavailable(res, node);
+        return;
+    }
+    res.status = r->status;
+    if (r->has_header("ETag")) res.set_header("ETag", r->get_header_value("ETag"));
+    if (r->status != 304) {
+        res.set_content(r->body, r->has_header("Content-Type")
+                                     ? r->get_header_value("Content-Type")
+                                     : std::string("application/json"));
+    }
+}
+
+void missingKey(httplib::Response &res) {
+    res.status = 400;
+    res.set_content(R"({"error":"Missing key"})", "application/json");
+}
+
+} // namespace
+
+// ------------------------------------------------------------
+//                        NODE POOL
+// ------------------------------------------------------------
+
+NodePool::Lease::Lease(std::shared_ptr<NodePool> pool, std::unique_ptr<httplib::Client> cli)
+    : pool(std::move(pool)), cli(std::move(cli)) {}
+
+NodePool::Lease::~Lease() {
+    if (cli) pool->release(std::move(cli));
+}
+
+NodePool::NodePool(const std::string& node, size_t maxIdle)
+    : address(node), maxIdle(maxIdle) {
+    auto colon = node.rfind(':');
+    host = node.substr(0, colon);
+    port = colon == std::string::npos ? 8080 : std::stoi(node.substr(colon + 1));
+}
+
+NodePool::~NodePool() = default;
+
+NodePool::Lease NodePool::acquire() {
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        if (!idle.empty()) {
+            auto cli = std::move(idle.back());
+            idle.pop_back();
+            return Lease(shared_from_this(), std::move(cli));
+        }
+    }
+
+    auto cli = std::make_unique<httplib::Client>(host, port);
+    cli->set_keep_alive(true);
+    cli->set_tcp_nodelay(true);
+    cli->set_connection_timeout(2, 0);
+    setTimeouts(*cli, kTimeoutSec);
+    return Lease(shared_from_this(), std::move(cli));
+}
+
+void NodePool::release(std::unique_ptr<httplib::Client> cli) {
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (idle.size() < maxIdle) idle.push_back(std::move(cli));
+}
+
+// ------------------------------------------------------------
+//                      CLUSTER ROUTER
+// ------------------------------------------------------------
+
+ClusterRouter::ClusterRouter(const std::vector<std::string>& nodes, size_t vnodes)
+    : ring(vnodes) {
+    for (const auto& n : nodes) {
+        ring.addNode(n);
+        pools.emplace(n, std::make_shared<NodePool>(n));
+    }
+}
+
+std::shared_lock<std::shared_mutex> ClusterRouter::sharedLock() {
+    std::lock_guard<std::mutex> lg(gate);
+    return std::shared_lock<std::shared_mutex>(mutex_);
+}
+
+std::unique_lock<std::shared_mutex> ClusterRouter::exclusiveLock() {
+    std::lock_guard<std::mutex> lg(gate);
+    return std::unique_lock<std::shared_mutex>(mutex_);
+}
+
+std::vector<std::string> ClusterRouter::nodes() {
+    auto lock = sharedLock();
+    return ring.nodes();
+}
+
+std::string ClusterRouter::ownerOf(const std::string& key) {
+    auto lock = sharedLock();
+    return ring.nodeFor(key);
+}
+
+std::shared_ptr<NodePool> ClusterRouter::poolFor(const std::string& node) {
+    auto lock = sharedLock();
+    return poolLocked(node);
+}
+
+std::shared_ptr<NodePool> ClusterRouter::poolLocked(const std::string& node) {
+    auto it = pools.find(node);
+    return it != pools.end() ? it->second : nullptr;
+}
+
+httplib::Result ClusterRouter::forwardWrite(const std::string& key, std::string& node,
+                                            const std::function<httplib::Result(httplib::Client&)>& send) {
+    auto lock = sharedLock();
+    node = ring.nodeFor(key);
+    if (next && next->nodeFor(key) != node) {
+        std::lock_guard<std::mutex> lg(dirtyMutex);
+        dirty.insert(key);
+    }
+
+    auto pool = poolLocked(node);
+    if (!pool) return httplib::Result();
+    auto lease = pool->acquire();
+
+    // mutex_ stays held across the call, so during a rebalance a stuck
+    // node would hold off the ring switch, and with it every routed write.
+    if (!next) return send(*lease.operator->());
+    setTimeouts(*lease.operator->(), kRebalanceTimeoutSec);
+    auto r = send(*lease.operator->());
+    setTimeouts(*lease.operator->(), kTimeoutSec);
+    return r;
+}
+
+// ---------------- REBALANCE ----------------
+bool ClusterRouter::migrate(const std::string& from, const HashRing& target,
+                            const std::vector<std::pair<std::uint64_t, std::uint64_t>>& ranges,
+                            std::vector<std::string>& moved, std::string& error) {
+    std::map<std::string, std::string> pending;   // target node -> NDJSON body
+    bool ok = true;
+
+    auto flush = [&](const std::string& node) {
+        std::string& body = pending[node];
+        if (body.empty()) return true;
+        auto pool = poolFor(node);
+        auto r = pool ? pool->acquire()->Post("/import", body, "application/x-ndjson")
+                      : httplib::Result();
+        body.clear();
+        if (!r || r->status != 200) {
+            error = "import into " + node + " failed";
+            return false;
+        }
+        return true;
+    };
+
+    BulkDecoder decoder(BulkFormat::NDJSON, [&](BulkRecord&& r) {
+        if (!ok) return;
+        const std::string& owner = target.nodeFor(r.key);
+        if (owner == from) return;
+
+        std::string& body = pending[owner];
+        encodeBulkRecord(BulkFormat::NDJSON, r, body);
+        moved.push_back(std::move(r.key));
+        if (body.size() >= kImportFlushBytes) ok = flush(owner);
+    });
+
+    // Imports are pushed while the source's dump is read, so memory stays
+    // bounded by kImportFlushBytes per target. The dump is as of its start:
+    // keys written meanwhile are picked up by catchUp().
+    auto pool = poolFor(from);
+    if (!pool) {
+        error = "export from " + from + " failed: unknown node";
+        return false;
+    }
+    auto receive = [&](const char* data, size_t len) {
+        return ok && decoder.feed(data, len);
+    };
+    auto r = ranges.empty()
+                 ? pool->acquire()->Get("/export", receive)
+                 : pool->acquire()->Post("/export", httplib::Headers{},
+                                         json{ {"ranges", ranges} }.dump(), "application/json", receive);
+
+    if (!ok) return false;
+    if (!r || r->status != 200 || !decoder.finish()) {
+        error = "export from " + from + " failed" +
+                (decoder.error().empty() ? "" : ": " + decoder.error());
+        return false;
+    }
+
+    for (auto& p : pending) {
+        if (!flush(p.first)) return false;
+    }
+    return true;
+}
+
+bool ClusterRouter::deleteKeys(const std::shared_ptr<NodePool>& pool,
+                               const std::vector<std::string>& keys, std::string& error) {
+    if (!pool) {
+        error = "cleanup failed: unknown node";
+        return false;
+    }
+    const std::string& node = pool->node();
+    auto lease = pool->acquire();
+    for (size_t i = 0; i < keys.size(); i += kDeleteBatch) {
+        size_t end = std::min(keys.size(), i + kDeleteBatch);
+        json body = { {"keys", json(std::vector<std::string>(keys.begin() + i, keys.begin() + end))} };
+        auto r = lease->Post("/mdel", body.dump(), "application/json");
+        if (!r || r->status != 200) {
+            error = "cleanup on " + node + " failed";
+            return false;
+        }
+    }
+    return true;
+}
+
+void ClusterRouter::beginRebalance(const HashRing& target) {
+    auto lock = exclusiveLock();
+    next = std::make_unique<HashRing>(target);
+    for (const auto& n : target.nodes()) {
+        if (!pools.count(n)) pools.emplace(n, std::make_shared<NodePool>(n));
+    }
+    std::lock_guard<std::mutex> lg(dirtyMutex);
+    dirty.clear();
+}
+
+void ClusterRouter::abortRebalance() {
+    auto lock = exclusiveLock();
+    for (const auto& n : next->nodes()) {
+        if (!ring.hasNode(n)) pools.erase(n);
+    }
+    next.reset();
+    std::lock_guard<std::mutex> lg(dirtyMutex);
+    dirty.clear();
+}
+
+bool ClusterRouter::catchUp(std::map<std::string, std::vector<std::string>>& moved,
+                            std::string& error) {
+    std::set<std::string> keys;
+    {
+        std::lock_guard<std::mutex> lg(dirtyMutex);
+        keys.swap(dirty);
+    }
+
+    std::map<std::string, std::vector<std::string>> byOwner;    // old owner -> keys
+    for (const auto& key : keys) byOwner[ring.nodeFor(key)].push_back(key);
+
+    // Current state of every dirty key on its old owner, fetched in batches
+    // with version and TTL: copied to the new owner, or deleted there if it
+    // is gone. Calls use the short timeout, as the final pass holds writes.
+    std::map<std::string, std::string> imports;                 // new owner -> NDJSON
+    std::map<std::string, std::vector<std::string>> deletes;    // new owner -> keys
+    for (const auto& group : byOwner) {
+        const std::string& from = group.first;
+        auto src = poolLocked(from)->acquire();
+        setTimeouts(*src.operator->(), kRebalanceTimeoutSec);
+
+        for (size_t i = 0; i < group.second.size(); i += kCatchUpReadBatch) {
+            std::vector<std::string> batch(group.second.begin() + i,
+                                           group.second.begin() + std::min(group.second.size(), i + kCatchUpReadBatch));
+            std::set<std::string> gone(batch.begin(), batch.end());
+            BulkDecoder decoder(BulkFormat::NDJSON, [&](BulkRecord&& r) {
+                if (!gone.erase(r.key)) return;   // not asked for
+                encodeBulkRecord(BulkFormat::NDJSON, r, imports[next->nodeFor(r.key)]);
+            });
+
+            auto r = src->Post("/export", json{ {"keys", batch} }.dump(), "application/json");
+            if (!r || r->status != 200 || !decoder.feed(r->body.data(), r->body.size()) ||
+                !decoder.finish()) {
+                setTimeouts(*src.operator->(), kTimeoutSec);
+                error = "catch-up read from " + from + " failed";
+                return false;
+            }
+            for (const auto& key : gone) deletes[next->nodeFor(key)].push_back(key);
+            auto& m = moved[from];
+            m.insert(m.end(), batch.begin(), batch.end());
+        }
+        setTimeouts(*src.operator->(), kTimeoutSec);
+    }
+
+    auto call = [&](const std::string& node, const char* path, const std::string& body,
+                    const char* contentType) {
+        auto lease = poolLocked(node)->acquire();
+        setTimeouts(*lease.operator->(), kRebalanceTimeoutSec);
+        auto r = lease->Post(path, body, contentType);
+        setTimeouts(*lease.operator->(), kTimeoutSec);
+        return r && r->status == 200;
+    };
+    for (const auto& im : imports) {
+        if (!call(im.first, "/import", im.second, "application/x-ndjson")) {
+            error = "catch-up import into " + im.first + " failed";
+            return false;
+        }
+    }
+    for (const auto& d : deletes) {
+        if (!call(d.first, "/mdel", json{ {"keys", d.second} }.dump(), "application/json")) {
+            error = "catch-up delete on " + d.first + " failed";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ClusterRouter::converge(std::map<std::string, std::vector<std::string>>& moved,
+                             std::string& error) {
+    for (int pass = 0; pass < kCatchUpPasses; ++pass) {
+        {
+            std::lock_guard<std::mutex> lg(dirtyMutex);
+            if (dirty.size() <= kCatchUpFinalKeys) return true;
+        }
+        if (!catchUp(moved, error)) return false;
+    }
+
+    // Writes keep outpacing the copy: rather than hold them for an
+    // unbounded final pass, give up and let the caller retry later.
+    std::lock_guard<std::mutex> lg(dirtyMutex);
+    if (dirty.size() > kCatchUpMaxFinalKeys) {
+        error = "writes outpace catch-up (" + std::to_string(dirty.size()) +
+                " moving keys still dirty); retry later";
+        return false;
+    }
+    return true;
+}
+
+long long ClusterRouter::addNode(const std::string& node, std::string& error) {
+    std::lock_guard<std::mutex> rebalance(rebalanceMutex);
+
+    HashRing target(0);
+    {
+        auto lock = sharedLock();
+        if (ring.hasNode(node)) {
+            error = "node already in ring";
+            return -1;
+        }
+        target = ring;
+    }
+    target.addNode(node);
+    beginRebalance(target);
+
+    // Only ranges now owned by the new node move; each old owner streams
+    // just the keys in them.
+    auto ranges = target.rangesFor(node);
+    std::map<std::string, std::vector<std::string>> moved;
+    for (const auto& source : target.nodes()) {
+        if (source == node) continue;
+        if (!migrate(source, target, ranges, moved[source], error)) {
+            abortRebalance();
+            return -1;
+        }
+    }
+
+    if (!converge(moved, error)) {
+        abortRebalance();
+        return -1;
+    }
+
+    // Holding mutex_ exclusively waits out in-flight writes and holds new
+    // ones until the keys they touched are copied and the ring switched.
+    {
+        auto lock = exclusiveLock();
+        if (!catchUp(moved, error)) {
+            lock.unlock();
+            abortRebalance();
+            return -1;
+        }
+        ring = target;
+        next.reset();
+    }
+
+    // Old copies are dropped only once reads are served by the new owner.
+    long long total = 0;
+    for (auto& m : moved) {
+        std::sort(m.second.begin(), m.second.end());
+        m.second.erase(std::unique(m.second.begin(), m.second.end()), m.second.end());
+        total += static_cast<long long>(m.second.size());
+        if (!deleteKeys(poolFor(m.first), m.second, error)) {
+            std::cerr << "[Router] " << error << " (stale copies remain)\n";
+        }
+    }
+    error.clear();
+    return total;
+}
+
+long long ClusterRouter::removeNode(const std::string& node, std::string& error) {
+    std::lock_guard<std::mutex> rebalance(rebalanceMutex);
+
+    HashRing target(0);
+    {
+        auto lock = sharedLock();
+        if (!ring.hasNode(node)) {
+            error = "node not in ring";
+            return -1;
+        }
+        if (ring.nodes().size() == 1) {
+            error = "cannot remove the last node";
+            return -1;
+        }
+        target = ring;
+    }
+    target.removeNode(node);
+    beginRebalance(target);
+
+    // Every key on the leaving node moves to its next owner clockwise.
+    std::map<std::string, std::vector<std::string>> moved;
+    if (!migrate(node, target, {}, moved[node], error) || !converge(moved, error)) {
+        abortRebalance();
+        return -1;
+    }
+
+    auto lock = exclusiveLock();
+    if (!catchUp(moved, error)) {
+        lock.unlock();
+        abortRebalance();
+        return -1;
+    }
+    ring = target;
+    next.reset();
+    auto leaving = poolLocked(node);
+    pools.erase(node);   // leases still out keep their pool alive
+    lock.unlock();
+
+    // Drop the leaving node's copies too: if it rejoins later, keys deleted
+    // in the meantime must not come back from it.
+    auto& keys = moved[node];
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    if (!deleteKeys(leaving, keys, error)) {
+        std::cerr << "[Router] " << error << " (stale copies remain)\n";
+    }
+    error.clear();
+    return static_cast<long long>(keys.size());
+}
+
+// ---------------- ROUTED API ----------------
+void ClusterRouter::start(const ServerConfig& config) {
+    httplib::Server svr;
+
+    // ----------- PUT -----------
+    svr.Post("/put", [&](const httplib::Request &req, httplib::Response &res) {
+        std::string key;
+        try {
+            key = json::parse(req.body).at("key").get<std::string>();
+        } catch (...) {
+            res.status = 400;
+            res.set_content(R"({"error":"Invalid JSON"})", "application/json");
+            return;
+        }
+
+        std::string node;
+        auto r = forwardWrite(key, node, [&](httplib::Client &cli) {
+            return cli.Post("/put", forwardHeaders(req), req.body, "application/json");
+        });
+        relay(r, node, res);
+    });
+
+    // ----------- GET / TTL -----------
+    for (const char *path : { "/get", "/ttl" }) {
+        svr.Get(path, [&, path](const httplib::Request &req, httplib::Response &res) {
+            if (!req.has_param("key")) return missingKey(res);
+
+            std::string key = req.get_param_value("key");
+            std::string node = ownerOf(key);
+            auto pool = poolFor(node);
+            if (!pool) return nodeUnavailable(res, node);
+            relay(pool->acquire()->Get(path, httplib::Params{{"key", key}}, forwardHeaders(req)), node, res);
+        });
+    }
+
+    // ----------- DELETE -----------
+    svr.Delete("/delete", [&](const httplib::Request &req, httplib::Response &res) {
+        if (!req.has_param("key")) return missingKey(res);
+
+        std::string key = req.get_param_value("key");
+        std::string node;
+        auto r = forwardWrite(key, node, [&](httplib::Client &cli) {
+            return cli.Delete("/delete", forwardHeaders(req), httplib::Params{{"key", key}});
+        });
+        relay(r, node, res);
+    });
+
+    // ----------- MULTI GET (parallel fan-out) -----------
+    svr.Post("/mget", [&](const httplib::Request &req, httplib::Response &res) {
+        std::map<std::string, std::vector<std::string>> byNode;
+        std::map<std::string, std::shared_ptr<NodePool>> groupPools;
+        try {
+            json body = json::parse(req.body);
+            auto lock = sharedLock();
+            for (const auto &k : body.at("keys")) {
+                std::string key = k.get<std::string>();
+                byNode[ring.nodeFor(key)].push_back(std::move(key));
+            }
+            for (const auto &group : byNode) groupPools[group.first] = poolLocked(group.first);
+        } catch (...) {
+            res.status = 400;
+            res.set_content(R"({"error":"Invalid JSON"})", "application/json");
+            return;
+        }
+
+        std::vector<std::pair<std::string, std::future<httplib::Result>>> calls;
+        for (auto &group : byNode) {
+            auto pool = groupPools[group.first];
+            std::string body = json{ {"keys", group.second} }.dump();
+            calls.emplace_back(group.first, std::async(std::launch::async, [pool, body] {
+                if (!pool) return httplib::Result();
+                auto lease = pool->acquire();
+                return lease->Post("/mget", body, "application/json");
+            }));
+        }
+
+        json values = json::object();
+        json missing = json::array();
+        json unavailable = json::array();
+        for (auto &call : calls) {
+            auto r = call.second.get();
+            if (!r || r->status != 200) {
+                for (const auto &k : byNode[call.first]) unavailable.push_back(k);
+                continue;
+            }
+            json part = json::parse(r->body, nullptr, false);
+            if (part.is_discarded()) {
+                for (const auto &k : byNode[call.first]) unavailable.push_back(k);
+                continue;
+            }
+            for (auto &kv : part["values"].items()) values[kv.key()] = kv.value();
+            for (auto &k : part["missing"]) missing.push_back(k);
+        }
+
+        json resp = { {"values", values}, {"missing", missing} };
+        if (!unavailable.empty()) resp["unavailable"] = unavailable;
+        res.set_content(resp.dump(), "application/json");
+    });
+
+    // ----------- CLUSTER STATS (fan-out) -----------
+    svr.Get("/stats", [&](const httplib::Request &, httplib::Response &res) {
+        std::vector<std::pair<std::string, std::future<httplib::Result>>> calls;
+        for (const auto &node : nodes()) {
+            auto pool = poolFor(node);
+            calls.emplace_back(node, std::async(std::launch::async, [pool] {
+                if (!pool) return httplib::Result();
+                auto lease = pool->acquire();
+                return lease->Get("/stats");
+            }));
+        }
+
+        size_t keys = 0;
+        json perNode = json::object();
+        for (auto &call : calls) {
+            auto r = call.second.get();
+            json s = r && r->status == 200 ? json::parse(r->body, nullptr, false) : json();
+            if (s.is_object()) keys += s.value("keys", size_t{0});
+            else s = { {"error", "node unavailable"} };
+            perNode[call.first] = s;
+        }
+
+        json resp = { {"router", true}, {"keys", keys}, {"nodes", perNode} };
+        res.set_content(resp.dump(), "application/json");
+    });
+
+    // ----------- CLUSTER MEMBERSHIP -----------
+    svr.Get("/cluster", [&](const httplib::Request &, httplib::Response &res) {
+        auto lock = sharedLock();
+        json resp = { {"nodes", ring.nodes()}, {"vnodes", ring.vnodes()} };
+        res.set_content(resp.dump(), "application/json");
+    });
+
+    auto membership = [&](bool add) {
+        return [&, add](const httplib::Request &req, httplib::Response &res) {
+            if (!req.has_param("node")) {
+                res.status = 400;
+                res.set_content(R"({"error":"Missing node"})", "application/json");
+                return;
+            }
+
+            std::string node = req.get_param_value("node");
+            std::string error;
+            long long moved = add ? addNode(node, error) : removeNode(node, error);
+            if (moved < 0) {
+                res.status = 409;
+                json resp = { {"error", error}, {"node", node} };
+                res.set_content(resp.dump(), "application/json");
+                return;
+            }
+
+            std::cout << "[Router] " << (add ? "added " : "removed ") << node
+                      << ", moved " << moved << " keys\n";
+            json resp = { {"node", node}, {"moved", moved}, {"nodes", nodes()} };
+            res.set_content(resp.dump(), "application/json");
+        };
+    };
+    svr.Post("/cluster/add", membership(true));
+    svr.Post("/cluster/remove", membership(false));
+
+    std::cout << "[Router] " << nodes().size() << " nodes, "
+              << ring.vnodes() << " virtual nodes each\n";
+    std::cout << "[Router] Running at http://localhost:" << config.port << "\n";
+    svr.listen(config.host, config.port);
+}
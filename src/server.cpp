@@ -3,30 +3,163 @@
 #include "persistence.h"
 #include "json.hpp"
 #include "httplib.h"
-#include "lru_cache.h"
+#include "bulk_io.h"
+#include "hash_ring.h"
 #include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
 
 using json = nlohmann::json;
 
-void startServer(KeyValueStore &store, Persistence &wal) {
-    httplib::Server svr;
+namespace {
 
-    // ----------- PUT (supports ttl) -----------
+std::string trim(const std::string &s) {
+    size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t");
+    return s.substr(b, e - b + 1);
+}
+
+// ETags are the key's store version, quoted: "42"
+std::string makeETag(std::uint64_t version) {
+    return "\"" + std::to_string(version) + "\"";
+}
+
+// Parses one entity tag ("42" or W/"42"). Returns false if malformed.
+// Numbers in KeyValueStore's sentinel range were never issued as versions;
+// they parse as NO_MATCH so a write conditioned on one fails with 412.
+bool parseETag(std::string tag, std::uint64_t &version) {
+    tag = trim(tag);
+    if (tag.rfind("W/", 0) == 0) tag.erase(0, 2);
+    if (tag.size() < 3 || tag.front() != '"' || tag.back() != '"') return false;
+
+    std::string digits = tag.substr(1, tag.size() - 2);
+    if (digits.find_first_not_of("0123456789") != std::string::npos) return false;
+    try { version = std::stoull(digits); } catch (...) { version = KeyValueStore::NO_MATCH; }
+    if (version >= KeyValueStore::NO_MATCH) version = KeyValueStore::NO_MATCH;
+    return version != 0;
+}
+
+// If-None-Match on reads: a comma-separated list of tags, or "*".
+bool etagListMatches(const std::string &header, std::uint64_t version) {
+    size_t start = 0;
+    while (start <= header.size()) {
+        size_t comma = header.find(',', start);
+        std::string tag = trim(header.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        std::uint64_t v = 0;
+        if (tag == "*" || (parseETag(tag, v) && v == version)) return true;
+        if (comma == std::string::npos) break;
+        start = comma + 1;
+    }
+    return false;
+}
+
+// Maps If-Match / If-None-Match on writes to KeyValueStore's `expected`.
+// Supports a single tag or "*" for If-Match, and "*" for If-None-Match.
+bool writePrecondition(const httplib::Request &req, std::uint64_t &expected) {
+    expected = KeyValueStore::ANY_VERSION;
+
+    if (req.has_header("If-Match")) {
+        std::string h = trim(req.get_header_value("If-Match"));
+        if (h == "*") { expected = KeyValueStore::MUST_EXIST; return true; }
+        return parseETag(h, expected);
+    }
+    if (req.has_header("If-None-Match")) {
+        if (trim(req.get_header_value("If-None-Match")) != "*") return false;
+        expected = KeyValueStore::MUST_NOT_EXIST;
+    }
+    return true;
+}
+
+void preconditionFailed(httplib::Response &res, const std::string &key, std::uint64_t current) {
+    res.status = 412;
+    if (current) res.set_header("ETag", makeETag(current));
+    json resp = { {"error", "Precondition failed"}, {"key", key} };
+    res.set_content(resp.dump(), "application/json");
+}
+
+using HashRanges = std::vector<std::pair<std::uint64_t, std::uint64_t>>;
+
+// [[lo, hi], ...] with inclusive bounds, in any order; sorted and merged.
+bool parseHashRanges(const json &j, HashRanges &out) {
+    if (!j.is_array()) return false;
+    for (const auto &r : j) {
+        if (!r.is_array() || r.size() != 2 || !r[0].is_number_unsigned() ||
+            !r[1].is_number_unsigned()) return false;
+        auto lo = r[0].get<std::uint64_t>(), hi = r[1].get<std::uint64_t>();
+        if (lo > hi) return false;
+        out.emplace_back(lo, hi);
+    }
+
+    std::sort(out.begin(), out.end());
+    HashRanges merged;
+    for (const auto &r : out) {
+        if (!merged.empty() && (merged.back().second == UINT64_MAX ||
+                                r.first <= merged.back().second + 1)) {
+            merged.back().second = std::max(merged.back().second, r.second);
+        } else {
+            merged.push_back(r);
+        }
+    }
+    out.swap(merged);
+    return true;
+}
+
+bool inHashRanges(const HashRanges &ranges, std::uint64_t h) {
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), std::make_pair(h, UINT64_MAX));
+    return it != ranges.begin() && h <= std::prev(it)->second;
+}
+
+} // namespace
+
+void startServer(KeyValueStore &store, Persistence &wal, const ServerConfig &config) {
+    // ----------- ADMISSION CONTROL -----------
+    AdmissionController admission(config.admission);
+    auto server = admission.makeServer();
+    httplib::Server &svr = *server;
+
+    svr.set_pre_routing_handler([&](const httplib::Request &req, httplib::Response &res) {
+        return admission.admit(req, res) ? httplib::Server::HandlerResponse::Unhandled
+                                         : httplib::Server::HandlerResponse::Handled;
+    });
+    svr.set_post_routing_handler([&](const httplib::Request &, httplib::Response &res) {
+        admission.release(res);
+    });
+
+    // ----------- PUT (supports ttl, If-Match / If-None-Match: *) -----------
     svr.Post("/put", [&](const httplib::Request &req, httplib::Response &res) {
+        std::uint64_t expected;
+        if (!writePrecondition(req, expected)) {
+            res.status = 400;
+            res.set_content(R"({"error":"Invalid precondition header"})", "application/json");
+            return;
+        }
+
         try {
             json body = json::parse(req.body);
 
             std::string key = body["key"];
             std::string value = body["value"];
 
-            store.put(key, value);
+            std::uint64_t version = 0;
+            if (!store.putIf(key, value, expected, version)) {
+                preconditionFailed(res, key, version);
+                return;
+            }
 
             if (body.contains("ttl")) {
                 long long ttl = body["ttl"];
                 store.setTTL(key, ttl);
             }
 
-            res.set_content(R"({"status":"OK","message":"Key added"})", "application/json");
+            json resp = { {"status", "OK"}, {"message", "Key added"}, {"version", version} };
+            res.set_header("ETag", makeETag(version));
+            res.set_content(resp.dump(), "application/json");
+        }
+        catch (const std::overflow_error &ex) {
+            res.status = 500;
+            res.set_content(json({ {"error", ex.what()} }).dump(), "application/json");
         }
         catch (...) {
             res.status = 400;
@@ -44,17 +177,82 @@ void startServer(KeyValueStore &store, Persistence &wal) {
 
         std::string key = req.get_param_value("key");
         bool found = false;
-        std::string value = store.get(key, found);
+        std::uint64_t version = 0;
+        std::string value = store.get(key, found, version);
+
+        if (found) {
+            res.set_header("ETag", makeETag(version));
+            if (req.has_header("If-None-Match") &&
+                etagListMatches(req.get_header_value("If-None-Match"), version)) {
+                res.status = 304;
+                return;
+            }
+        }
 
         json resp;
         resp["found"] = found;
         resp["key"] = key;
-        if (found) resp["value"] = value;
+        if (found) {
+            resp["value"] = value;
+            resp["version"] = version;
+        }
 
         res.set_content(resp.dump(), "application/json");
     });
 
-    // ----------- DELETE -----------
+    // ----------- MULTI GET -----------
+    // body: {"keys":[...]} -> {"values":{key:value,...},"missing":[...]}
+    svr.Post("/mget", [&](const httplib::Request &req, httplib::Response &res) {
+        try {
+            json body = json::parse(req.body);
+            json values = json::object();
+            json missing = json::array();
+
+            for (const auto &k : body.at("keys")) {
+                std::string key = k.get<std::string>();
+                bool found = false;
+                std::string value = store.get(key, found);
+                if (found) values[key] = value;
+                else missing.push_back(key);
+            }
+
+            json resp = { {"values", values}, {"missing", missing} };
+            res.set_content(resp.dump(), "application/json");
+        }
+        catch (...) {
+            res.status = 400;
+            res.set_content(R"({"error":"Invalid JSON"})", "application/json");
+        }
+    });
+
+    // ----------- MULTI DELETE -----------
+    // body: {"keys":[...]} -> {"deleted":n}
+    // Logged as one WAL write with a single fsync, like /import.
+    svr.Post("/mdel", [&](const httplib::Request &req, httplib::Response &res) {
+        try {
+            json body = json::parse(req.body);
+            std::vector<std::pair<std::string, std::uint64_t>> deleted;
+
+            for (const auto &k : body.at("keys")) {
+                std::string key = k.get<std::string>();
+                std::uint64_t version = 0;
+                if (store.delIf(key, KeyValueStore::ANY_VERSION, version, /*persist=*/false)) {
+                    deleted.emplace_back(std::move(key), version);
+                }
+            }
+
+            bool synced = wal.appendDelBatch(deleted) && wal.sync();
+
+            json resp = { {"deleted", deleted.size()}, {"synced", synced} };
+            res.set_content(resp.dump(), "application/json");
+        }
+        catch (...) {
+            res.status = 400;
+            res.set_content(R"({"error":"Invalid JSON"})", "application/json");
+        }
+    });
+
+    // ----------- DELETE (supports If-Match) -----------
     svr.Delete("/delete", [&](const httplib::Request &req, httplib::Response &res) {
         if (!req.has_param("key")) {
             res.status = 400;
@@ -62,8 +260,21 @@ void startServer(KeyValueStore &store, Persistence &wal) {
             return;
         }
 
+        std::uint64_t expected;
+        if (!writePrecondition(req, expected) || expected == KeyValueStore::MUST_NOT_EXIST) {
+            res.status = 400;
+            res.set_content(R"({"error":"Invalid precondition header"})", "application/json");
+            return;
+        }
+
         std::string key = req.get_param_value("key");
-        bool ok = store.del(key);
+        std::uint64_t version = 0;
+        bool ok = store.delIf(key, expected, version);
+
+        if (!ok && expected != KeyValueStore::ANY_VERSION) {
+            preconditionFailed(res, key, version);
+            return;
+        }
 
         json resp = { {"deleted", ok}, {"key", key} };
         res.set_content(resp.dump(), "application/json");
@@ -72,57 +283,207 @@ void startServer(KeyValueStore &store, Persistence &wal) {
     // ----------- COMPACT WAL -----------
     svr.Post("/compact", [&](const httplib::Request &, httplib::Response &res) {
         auto snap = store.snapshot();
-        bool ok = wal.compact(snap);
+        bool ok = wal.compact(snap, store.currentVersion());
 
         json resp = { {"compacted", ok} };
         res.set_content(resp.dump(), "application/json");
     });
 
+    // ----------- BULK IMPORT (streamed) -----------
+    // Body is NDJSON (default) or binary (Content-Type: application/octet-stream),
+    // plain or chunked. Records are applied in batches straight to the store
+    // and WAL without per-key fsync; the WAL is fsynced once at the end.
+    svr.Post("/import", [&](const httplib::Request &req, httplib::Response &res,
+                            const httplib::ContentReader &content_reader) {
+        constexpr size_t kMaxBatch = 100000;
+        size_t batchSize = 10000;
+        if (req.has_param("batch")) {
+            const std::string p = req.get_param_value("batch");
+            bool digits = !p.empty() &&
+                          std::all_of(p.begin(), p.end(), [](unsigned char c) { return std::isdigit(c); });
+            batchSize = !digits ? 0 : p.size() > 9 ? kMaxBatch : std::min<size_t>(std::stoul(p), kMaxBatch);
+            if (batchSize == 0) {
+                res.status = 400;
+                res.set_content(R"({"error":"batch must be a positive integer"})", "application/json");
+                return;
+            }
+        }
+
+        BulkFormat format = bulkFormatFromContentType(req.get_header_value("Content-Type"));
+        std::vector<BulkRecord> batch;
+        batch.reserve(batchSize);
+        size_t imported = 0;
+        size_t batches = 0;
+        bool walOk = true;
+
+        auto flush = [&]() {
+            if (batch.empty()) return;
+            imported += store.putBatch(batch);
+            walOk = wal.appendSetBatch(batch) && walOk;
+            batches++;
+            batch.clear();
+        };
+
+        BulkDecoder decoder(format, [&](BulkRecord &&r) {
+            batch.push_back(std::move(r));
+            if (batch.size() >= batchSize) flush();
+        });
+
+        bool ok = content_reader([&](const char *data, size_t len) {
+            return decoder.feed(data, len);
+        });
+        if (ok) ok = decoder.finish();
+
+        flush();
+        bool synced = wal.sync();
+
+        json resp = {
+            {"imported", imported},
+            {"batches", batches},
+            {"synced", synced && walOk}
+        };
+        if (!ok) {
+            res.status = 400;
+            resp["error"] = decoder.error().empty() ? "stream aborted" : decoder.error();
+        } else if (!synced || !walOk) {
+            // applied but not durable: must not be acknowledged
+            res.status = 500;
+            resp["error"] = "WAL write failed";
+        }
+        res.set_content(resp.dump(), "application/json");
+    });
+
+    // ----------- BULK EXPORT (streamed) -----------
+    // Streams a point-in-time dump as NDJSON or binary (?format=binary),
+    // encoding straight from the store instead of copying a snapshot;
+    // KeyValueStore::forEach keeps pre-images of keys written meanwhile.
+    auto streamExport = [&store](const httplib::Request &req, httplib::Response &res,
+                                 KeyValueStore::KeyFilter filter) {
+        BulkFormat format = req.get_param_value("format") == "binary"
+                                ? BulkFormat::Binary : BulkFormat::NDJSON;
+
+        res.set_chunked_content_provider(bulkContentType(format),
+            [&store, format, filter](size_t, httplib::DataSink &sink) {
+                constexpr size_t kFlushBytes = 64 * 1024;
+                std::string buf;
+                buf.reserve(kFlushBytes * 2);
+                bool ok = true;
+
+                // An exception escaping a content provider terminates the
+                // process; abort the stream (the client sees it cut short).
+                try {
+                    store.forEach([&](const BulkRecord &r) {
+                        encodeBulkRecord(format, r, buf);
+                        if (buf.size() >= kFlushBytes) {
+                            ok = sink.write(buf.data(), buf.size());
+                            buf.clear();
+                        }
+                        return ok;
+                    }, 1024, filter);
+                } catch (const std::exception &ex) {
+                    std::cerr << "[Export] aborted: " << ex.what() << "\n";
+                    return false;
+                }
+
+                if (ok && !buf.empty()) ok = sink.write(buf.data(), buf.size());
+                if (ok) sink.done();
+                return ok;
+            });
+    };
+
+    svr.Get("/export", [&](const httplib::Request &req, httplib::Response &res) {
+        streamExport(req, res, nullptr);
+    });
+
+    // Same dump limited to keys whose HashRing::hash falls in one of
+    // {"ranges":[[lo,hi],...]}, so a rebalance only reads the ranges that move.
+    // {"keys":[...]} instead returns those keys' current records in one
+    // response (absent keys are left out), for the rebalance catch-up.
+    svr.Post("/export", [&](const httplib::Request &req, httplib::Response &res) {
+        json body = json::parse(req.body, nullptr, false);
+
+        if (body.is_object() && body.contains("keys")) {
+            std::vector<std::string> keys;
+            try {
+                keys = body["keys"].get<std::vector<std::string>>();
+            } catch (...) {
+                res.status = 400;
+                res.set_content(R"({"error":"Invalid keys"})", "application/json");
+                return;
+            }
+
+            BulkFormat format = req.get_param_value("format") == "binary"
+                                    ? BulkFormat::Binary : BulkFormat::NDJSON;
+            std::string out;
+            for (const auto &r : store.getRecords(keys)) encodeBulkRecord(format, r, out);
+            res.set_content(std::move(out), bulkContentType(format));
+            return;
+        }
+
+        HashRanges ranges;
+        if (!body.is_object() || !body.contains("ranges") || !parseHashRanges(body["ranges"], ranges)) {
+            res.status = 400;
+            res.set_content(R"({"error":"Invalid ranges"})", "application/json");
+            return;
+        }
+        streamExport(req, res, [ranges](const std::string &key) {
+            return inHashRanges(ranges, HashRing::hash(key));
+        });
+    });
+
     // ----------- WAL/STORE STATS -----------
     svr.Get("/stats", [&](const httplib::Request &, httplib::Response &res) {
         json resp = {
             {"keys", store.size()},
             {"wal_path", wal.path()}
         };
+
+        auto a = admission.stats();
+        resp["admission"] = {
+            {"workers", a.workers},
+            {"queue_depth", a.queueDepth},
+            {"write_slots", a.writeSlots},
+            {"admitted", a.admitted},
+            {"queued", a.queued},
+            {"queue_length", a.queueLength},
+            {"queue_peak", a.queuePeak},
+            {"queue_delay_ms", a.queueDelayMs},
+            {"overloaded", a.overloaded},
+            {"writes_in_flight", a.writesInFlight},
+            {"shed", {
+                {"total", a.shedQueueDelay + a.shedQueueFull + a.shedWrites},
+                {"queue_delay", a.shedQueueDelay},
+                {"queue_full", a.shedQueueFull},
+                {"write_slots", a.shedWrites},
+                {"rejected", a.rejected}
+            }}
+        };
         res.set_content(resp.dump(), "application/json");
     });
 
     // ----------- CACHE STATS -----------
     svr.Get("/cache/stats", [&](const httplib::Request &, httplib::Response &res) {
-        LRUCache* c = store.getCache();
-        if (!c) {
-            res.status = 404;
-            res.set_content(R"({"error":"no cache attached"})", "application/json");
-            return;
-        }
-
-        auto s = c->getStats();
+        auto s = store.getCacheStats();
         json resp = {
             {"hits", s.hits},
             {"misses", s.misses},
             {"evictions", s.evictions},
-            {"items", c->size()}
+            {"items", store.size()},
+            {"capacity", store.capacity()}
         };
         res.set_content(resp.dump(), "application/json");
     });
 
     // ----------- RESET CACHE STATS -----------
     svr.Post("/cache/stats/reset", [&](const httplib::Request &, httplib::Response &res) {
-        LRUCache* c = store.getCache();
-        if (!c) {
-            res.status = 404;
-            res.set_content(R"({"error":"no cache attached"})", "application/json");
-            return;
-        }
-
-        c->resetStats();
-        auto s = c->getStats();
+        store.resetCacheStats();
+        auto s = store.getCacheStats();
         json resp = {
             {"reset", true},
             {"hits", s.hits},
             {"misses", s.misses},
             {"evictions", s.evictions},
-            {"items", c->size()}
+            {"items", store.size()}
         };
         res.set_content(resp.dump(), "application/json");
     });
@@ -145,6 +506,6 @@ void startServer(KeyValueStore &store, Persistence &wal) {
         res.set_content(resp.dump(), "application/json");
     });
 
-    std::cout << "[Server] Running at http://localhost:8080\n";
-    svr.listen("0.0.0.0", 8080);
+    std::cout << "[Server] Running at http://localhost:" << config.port << "\n";
+    svr.listen(config.host, config.port);
 }
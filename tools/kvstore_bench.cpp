@@ -0,0 +1,275 @@
+// algovault_bench — micro-benchmark for KeyValueStore hot paths.
+//
+// Runs each operation against an in-process store (no WAL) and reports
+// ns/op plus, because this target is built with ALGOVAULT_OP_COUNTERS,
+// the lock acquisitions and hash probes each operation costs.
+//
+// --baseline runs the same operations against LegacyStore, a copy of the
+// store's earlier layout (value map + expiry map + a separately locked
+// LRUCache) counted the same way, for before/after comparisons.
+//
+//   ./algovault_bench [--keys N] [--threads N] [--baseline]
+
+#include "kvstore.h"
+#include "json.hpp"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Counts {
+    std::uint64_t locks = 0;
+    std::uint64_t probes = 0;
+};
+
+Counts readCounters() {
+    auto& c = KeyValueStore::opCounters();
+    return { c.locks.load(), c.probes.load() };
+}
+
+// Runs fn(i) for i in [0, n) on `threads` threads and reports per-op cost.
+template <typename Fn>
+json measure(const char* name, size_t n, int threads, Fn fn) {
+    Counts before = readCounters();
+    auto start = Clock::now();
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            for (size_t i = t; i < n; i += threads) fn(i);
+        });
+    }
+    for (auto& th : pool) th.join();
+
+    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+    Counts after = readCounters();
+    double ops = static_cast<double>(n);
+
+    json j = {
+        {"op", name},
+        {"threads", threads},
+        {"ops", n},
+        {"ns_per_op", secs * 1e9 / ops * threads},
+        {"ops_per_sec", ops / secs},
+        {"locks_per_op", (after.locks - before.locks) / ops},
+        {"probes_per_op", (after.probes - before.probes) / ops}
+    };
+    std::cerr << "[bench] " << name << " done\n";
+    return j;
+}
+
+std::string key(size_t i) { return "key:" + std::to_string(i); }
+
+#define COUNT_LOCK()  KeyValueStore::opCounters().locks.fetch_add(1, std::memory_order_relaxed)
+#define COUNT_PROBE() KeyValueStore::opCounters().probes.fetch_add(1, std::memory_order_relaxed)
+
+// ------------------------------------------------------------
+//          LEGACY STORE (layout before the Entry record)
+// ------------------------------------------------------------
+
+// The old LRUCache: its own lock, list of (key, value), key -> list node.
+class LegacyCache {
+public:
+    explicit LegacyCache(size_t capacity) : capacity(capacity ? capacity : 1) {}
+
+    void put(const std::string& k, const std::string& v) {
+        COUNT_LOCK();
+        std::unique_lock lock(mutex_);
+        COUNT_PROBE();
+        auto it = map.find(k);
+        if (it != map.end()) {
+            it->second->second = v;
+            lru.splice(lru.begin(), lru, it->second);
+            COUNT_PROBE();
+            map[k] = lru.begin();
+            return;
+        }
+        if (lru.size() >= capacity) {
+            COUNT_PROBE();
+            map.erase(lru.back().first);
+            lru.pop_back();
+        }
+        lru.emplace_front(k, v);
+        COUNT_PROBE();
+        map[k] = lru.begin();
+    }
+
+    bool get(const std::string& k, std::string& v) {
+        COUNT_LOCK();
+        std::unique_lock lock(mutex_);
+        COUNT_PROBE();
+        auto it = map.find(k);
+        if (it == map.end()) return false;
+        v = it->second->second;
+        lru.splice(lru.begin(), lru, it->second);
+        COUNT_PROBE();
+        map[k] = lru.begin();
+        return true;
+    }
+
+    bool exists(const std::string& k) {
+        COUNT_LOCK();
+        std::shared_lock lock(mutex_);
+        COUNT_PROBE();
+        return map.find(k) != map.end();
+    }
+
+private:
+    using List = std::list<std::pair<std::string, std::string>>;
+    size_t capacity;
+    List lru;
+    std::unordered_map<std::string, List::iterator> map;
+    std::shared_mutex mutex_;
+};
+
+// The old KeyValueStore read/write paths: TTL check, cache, then store.
+class LegacyStore {
+public:
+    explicit LegacyStore(size_t capacity) : cache(capacity) {}
+
+    void put(const std::string& k, const std::string& v, bool) {
+        {
+            COUNT_LOCK();
+            std::unique_lock lock(mutex_);
+            COUNT_PROBE();
+            store[k] = v;
+        }
+        cache.put(k, v);
+    }
+
+    std::string get(const std::string& k, bool& found) {
+        found = false;
+        if (isExpired(k)) return "";
+
+        std::string v;
+        if (cache.get(k, v)) {
+            found = true;
+            return v;
+        }
+
+        COUNT_LOCK();
+        std::shared_lock lock(mutex_);
+        COUNT_PROBE();
+        auto it = store.find(k);
+        if (it == store.end()) return "";
+        found = true;
+        cache.put(k, it->second);
+        return it->second;
+    }
+
+    bool exists(const std::string& k) {
+        if (isExpired(k)) return false;
+        if (cache.exists(k)) return true;
+
+        COUNT_LOCK();
+        std::shared_lock lock(mutex_);
+        COUNT_PROBE();
+        return store.find(k) != store.end();
+    }
+
+    void setTTL(const std::string& k, long long ttlSeconds) {
+        COUNT_LOCK();
+        std::unique_lock lock(mutex_);
+        COUNT_PROBE();
+        expiry[k] = nowMs() + ttlSeconds * 1000;
+    }
+
+private:
+    LegacyCache cache;
+    std::unordered_map<std::string, std::string> store;
+    std::unordered_map<std::string, long long> expiry;
+    std::shared_mutex mutex_;
+
+    static long long nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool isExpired(const std::string& k) {
+        {
+            COUNT_LOCK();
+            std::shared_lock lock(mutex_);
+            COUNT_PROBE();
+            auto it = expiry.find(k);
+            if (it == expiry.end() || nowMs() <= it->second) return false;
+        }
+        // del(): store + expiry under one lock, then the cache
+        {
+            COUNT_LOCK();
+            std::unique_lock lock(mutex_);
+            COUNT_PROBE();
+            store.erase(k);
+            COUNT_PROBE();
+            expiry.erase(k);
+        }
+        return true;
+    }
+};
+
+// Runs every benchmark against Store (KeyValueStore or LegacyStore).
+template <typename Store>
+json runAll(size_t keys, int threads, const std::function<std::unique_ptr<Store>()>& make) {
+    std::string value(100, 'v');
+    auto store = make();
+    json results = json::array();
+    bool found = false;
+
+    results.push_back(measure("put_insert", keys, 1, [&](size_t i) { store->put(key(i), value, false); }));
+    results.push_back(measure("put_update", keys, 1, [&](size_t i) { store->put(key(i), value, false); }));
+    results.push_back(measure("get_hit", keys, 1, [&](size_t i) { store->get(key(i), found); }));
+    results.push_back(measure("get_miss", keys, 1, [&](size_t i) { store->get(key(i + keys), found); }));
+    results.push_back(measure("exists_hit", keys, 1, [&](size_t i) { store->exists(key(i)); }));
+
+    // TTL'd keys that have already lapsed: get() must drop them.
+    auto expiring = make();
+    for (size_t i = 0; i < keys; ++i) {
+        expiring->put(key(i), value, false);
+        expiring->setTTL(key(i), -1);
+    }
+    results.push_back(measure("get_expired", keys, 1, [&](size_t i) {
+        bool f = false;
+        expiring->get(key(i), f);
+    }));
+
+    results.push_back(measure("get_hit_mt", keys * 4, threads, [&](size_t i) {
+        bool f = false;
+        store->get(key(i % keys), f);
+    }));
+    return results;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t keys = 200000;
+    int threads = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+    bool baseline = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--baseline") baseline = true;
+        else if (a == "--keys" && i + 1 < argc) keys = std::stoul(argv[++i]);
+        else if (a == "--threads" && i + 1 < argc) threads = std::stoi(argv[++i]);
+    }
+
+    json results = baseline
+        ? runAll<LegacyStore>(keys, threads, [&] { return std::make_unique<LegacyStore>(keys * 2); })
+        : runAll<KeyValueStore>(keys, threads, [] { return std::make_unique<KeyValueStore>(); });
+
+    std::cout << json{ {"store", baseline ? "legacy" : "entry"}, {"keys", keys},
+                       {"results", results} }.dump(2) << std::endl;
+    return 0;
+}
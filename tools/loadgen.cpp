@@ -0,0 +1,651 @@
+// algovault_loadgen — YCSB-style load generator for AlgoVault.
+//
+// Drives either the in-process KeyValueStore API or the HTTP server
+// (keep-alive connections, one per thread) with the YCSB core workloads
+// A–F, and prints throughput and latency percentiles as JSON.
+//
+//   ./algovault_loadgen --workload a --mode http --threads 16 --ops 200000
+//   ./algovault_loadgen --workload b --mode inproc --distribution uniform
+//   ./algovault_loadgen --workload a --target-rate 20000 --duration 30
+
+#include "kvstore.h"
+#include "persistence.h"
+#include "httplib.h"
+#include "json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+// ------------------------------------------------------------
+//                        OPTIONS
+// ------------------------------------------------------------
+
+constexpr size_t kMinKeySize = 8;
+
+struct Options {
+    std::string workload = "a";
+    std::string mode = "inproc";          // inproc | http
+    std::string host = "127.0.0.1";
+    int port = 8080;
+
+    std::string distribution;             // uniform | zipfian | latest (empty = workload default)
+    double readProportion = -1;
+    double updateProportion = -1;
+    double insertProportion = -1;
+    double scanProportion = -1;
+    double rmwProportion = -1;
+
+    uint64_t records = 10000;
+    uint64_t ops = 100000;
+    double duration = 0;                  // seconds; 0 = run until ops are done
+    int threads = 8;
+    double targetRate = 0;                // ops/sec across all threads; 0 = closed loop
+
+    size_t keySize = 16;
+    size_t valueSize = 100;
+    size_t maxScanLength = 10;
+    double ttlRatio = 0;                  // fraction of writes that carry a TTL
+    long long ttlSeconds = 60;
+
+    size_t cacheCapacity = 0;             // inproc LRU capacity; 0 = unbounded
+    std::string walPath;                  // inproc: empty = no WAL
+    bool skipLoad = false;
+    uint64_t seed = 42;
+};
+
+static void usage() {
+    std::cerr <<
+        "usage: algovault_loadgen [options]\n"
+        "  --workload a|b|c|d|e|f     YCSB core workload preset (default a)\n"
+        "  --mode inproc|http         drive KeyValueStore directly or over HTTP\n"
+        "  --host H --port P          HTTP target (default 127.0.0.1:8080)\n"
+        "  --distribution D           uniform | zipfian | latest\n"
+        "  --read R --update U --insert I --scan S --rmw M   operation mix overrides\n"
+        "  --records N                keys loaded before the run (default 10000)\n"
+        "  --ops N                    operations in the run phase (default 100000)\n"
+        "  --duration SEC             stop after SEC seconds instead of --ops\n"
+        "  --threads N                client threads (default 8)\n"
+        "  --target-rate OPS          open loop at OPS ops/sec (default closed loop)\n"
+        "  --key-size B --value-size B --max-scan-length N   (key size >= 8)\n"
+        "  --ttl-ratio F --ttl SEC    fraction of writes carrying a TTL\n"
+        "  --cache-capacity N --wal PATH   inproc store configuration\n"
+        "  --skip-load                assume records were loaded by a previous run\n"
+        "  --seed N\n";
+}
+
+static bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for " + a);
+            return argv[++i];
+        };
+
+        if (a == "--workload") o.workload = next();
+        else if (a == "--mode") o.mode = next();
+        else if (a == "--host") o.host = next();
+        else if (a == "--port") o.port = std::stoi(next());
+        else if (a == "--distribution") o.distribution = next();
+        else if (a == "--read") o.readProportion = std::stod(next());
+        else if (a == "--update") o.updateProportion = std::stod(next());
+        else if (a == "--insert") o.insertProportion = std::stod(next());
+        else if (a == "--scan") o.scanProportion = std::stod(next());
+        else if (a == "--rmw") o.rmwProportion = std::stod(next());
+        else if (a == "--records") o.records = std::stoull(next());
+        else if (a == "--ops") o.ops = std::stoull(next());
+        else if (a == "--duration") o.duration = std::stod(next());
+        else if (a == "--threads") o.threads = std::stoi(next());
+        else if (a == "--target-rate") o.targetRate = std::stod(next());
+        else if (a == "--key-size") {
+            o.keySize = std::stoul(next());
+            if (o.keySize < kMinKeySize)
+                throw std::invalid_argument("--key-size must be at least " + std::to_string(kMinKeySize));
+        }
+        else if (a == "--value-size") o.valueSize = std::stoul(next());
+        else if (a == "--max-scan-length") o.maxScanLength = std::stoul(next());
+        else if (a == "--ttl-ratio") o.ttlRatio = std::stod(next());
+        else if (a == "--ttl") o.ttlSeconds = std::stoll(next());
+        else if (a == "--cache-capacity") o.cacheCapacity = std::stoul(next());
+        else if (a == "--wal") o.walPath = next();
+        else if (a == "--skip-load") o.skipLoad = true;
+        else if (a == "--seed") o.seed = std::stoull(next());
+        else if (a == "--help" || a == "-h") return false;
+        else throw std::invalid_argument("unknown option " + a);
+    }
+    if (o.threads < 1) o.threads = 1;
+    if (o.records == 0) o.records = 1;
+    if (o.maxScanLength == 0) o.maxScanLength = 1;
+    return true;
+}
+
+// ------------------------------------------------------------
+//                        WORKLOADS
+// ------------------------------------------------------------
+
+enum class Op { Read, Update, Insert, Scan, ReadModifyWrite };
+static constexpr int kOpCount = 5;
+static const char* kOpNames[kOpCount] = { "read", "update", "insert", "scan", "rmw" };
+
+struct Mix {
+    double read = 0, update = 0, insert = 0, scan = 0, rmw = 0;
+    std::string distribution;
+};
+
+// YCSB core workloads (see ycsb/workloads/workload[a-f]).
+static Mix presetMix(const std::string& w) {
+    if (w == "a") return { 0.50, 0.50, 0,    0,    0,    "zipfian" };
+    if (w == "b") return { 0.95, 0.05, 0,    0,    0,    "zipfian" };
+    if (w == "c") return { 1.00, 0,    0,    0,    0,    "zipfian" };
+    if (w == "d") return { 0.95, 0,    0.05, 0,    0,    "latest"  };
+    if (w == "e") return { 0,    0,    0.05, 0.95, 0,    "zipfian" };
+    if (w == "f") return { 0.50, 0,    0,    0,    0.50, "zipfian" };
+    throw std::invalid_argument("unknown workload '" + w + "' (expected a-f)");
+}
+
+static Mix resolveMix(const Options& o) {
+    Mix m = presetMix(o.workload);
+    if (o.readProportion >= 0) m.read = o.readProportion;
+    if (o.updateProportion >= 0) m.update = o.updateProportion;
+    if (o.insertProportion >= 0) m.insert = o.insertProportion;
+    if (o.scanProportion >= 0) m.scan = o.scanProportion;
+    if (o.rmwProportion >= 0) m.rmw = o.rmwProportion;
+    if (!o.distribution.empty()) m.distribution = o.distribution;
+
+    if (m.distribution != "uniform" && m.distribution != "zipfian" && m.distribution != "latest")
+        throw std::invalid_argument("unknown distribution '" + m.distribution + "'");
+    if (m.read + m.update + m.insert + m.scan + m.rmw <= 0)
+        throw std::invalid_argument("operation mix is empty");
+    return m;
+}
+
+// ------------------------------------------------------------
+//                    KEY DISTRIBUTIONS
+// ------------------------------------------------------------
+
+static uint64_t fnv1a64(uint64_t v) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < 8; ++i) {
+        h ^= v & 0xff;
+        h *= 0x100000001b3ULL;
+        v >>= 8;
+    }
+    return h;
+}
+
+// Zipfian over [0, n) with the YCSB constant (0.99), using the
+// Gray et al. "Quickly generating billion-record synthetic databases"
+// method. zeta(n) is computed once and shared by every thread.
+class ZipfianGenerator {
+public:
+    explicit ZipfianGenerator(uint64_t n, double theta = 0.99)
+        : items(n), theta(theta) {
+        zeta2 = zeta(2);
+        zetaN = zeta(n);
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetaN);
+    }
+
+    // u is uniform in [0, 1); returns a rank, 0 being the most popular.
+    uint64_t next(double u) const { return next(u, items); }
+
+    // Draw over a prefix [0, n) of the original item space. Used by the
+    // "latest" distribution as the keyspace grows; zeta is not recomputed,
+    // which skews slightly toward hot items — same trade-off YCSB makes.
+    uint64_t next(double u, uint64_t n) const {
+        double uz = u * zetaN;
+        uint64_t r;
+        if (uz < 1.0) r = 0;
+        else if (uz < 1.0 + std::pow(0.5, theta)) r = 1;
+        else r = static_cast<uint64_t>(n * std::pow(eta * u - eta + 1, alpha));
+        return std::min(r, n - 1);
+    }
+
+private:
+    uint64_t items;
+    double theta, zeta2, zetaN, alpha, eta;
+
+    double zeta(uint64_t n) const {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i) sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        return sum;
+    }
+};
+
+// Picks the record index for reads/updates/scans.
+class KeyChooser {
+public:
+    KeyChooser(const std::string& dist, uint64_t records, const std::atomic<uint64_t>& inserted)
+        : dist(dist), inserted(inserted), zipf(std::max<uint64_t>(records, 2)) {}
+
+    uint64_t next(std::mt19937_64& rng) const {
+        uint64_t n = std::max<uint64_t>(inserted.load(std::memory_order_relaxed), 1);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+
+        if (dist == "uniform") {
+            return std::uniform_int_distribution<uint64_t>(0, n - 1)(rng);
+        }
+        if (dist == "latest") {
+            // Most recently inserted records are the hottest.
+            uint64_t r = zipf.next(u(rng), n);
+            return n - 1 - r;
+        }
+        // Scrambled zipfian: popular ranks are spread over the keyspace
+        // instead of clustering at the low indices.
+        return fnv1a64(zipf.next(u(rng))) % n;
+    }
+
+private:
+    std::string dist;
+    const std::atomic<uint64_t>& inserted;
+    ZipfianGenerator zipf;
+};
+
+// ------------------------------------------------------------
+//                   LATENCY HISTOGRAM
+// ------------------------------------------------------------
+
+// Log-linear histogram in nanoseconds: exact below 128ns, then 64
+// sub-buckets per power of two (< 1.6% relative error).
+class LatencyHistogram {
+public:
+    LatencyHistogram() : buckets(kDirect + 57 * kSub, 0) {}
+
+    void record(uint64_t ns) {
+        buckets[indexOf(ns)]++;
+        count++;
+        sum += ns;
+        maxNs = std::max(maxNs, ns);
+    }
+
+    void merge(const LatencyHistogram& o) {
+        for (size_t i = 0; i < buckets.size(); ++i) buckets[i] += o.buckets[i];
+        count += o.count;
+        sum += o.sum;
+        maxNs = std::max(maxNs, o.maxNs);
+    }
+
+    uint64_t percentile(double p) const {
+        if (count == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * count));
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            seen += buckets[i];
+            if (seen >= rank) return std::min(upperBound(i), maxNs);
+        }
+        return maxNs;
+    }
+
+    json toJson() const {
+        auto us = [](uint64_t ns) { return ns / 1000.0; };
+        return {
+            {"count", count},
+            {"mean_us", count ? us(sum / count) : 0.0},
+            {"p50_us", us(percentile(50))},
+            {"p99_us", us(percentile(99))},
+            {"p999_us", us(percentile(99.9))},
+            {"max_us", us(maxNs)}
+        };
+    }
+
+    uint64_t total() const { return count; }
+
+private:
+    static constexpr int kSubBits = 6;
+    static constexpr size_t kSub = size_t(1) << kSubBits;   // 64
+    static constexpr size_t kDirect = kSub * 2;             // 128
+
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0, sum = 0, maxNs = 0;
+
+    static size_t indexOf(uint64_t v) {
+        if (v < kDirect) return static_cast<size_t>(v);
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - kSubBits;                  // >= 1
+        uint64_t sub = (v >> shift) - kSub;          // [0, 64)
+        return kDirect + (shift - 1) * kSub + sub;
+    }
+
+    static uint64_t upperBound(size_t idx) {
+        if (idx < kDirect) return idx;
+        size_t shift = (idx - kDirect) / kSub + 1;
+        uint64_t sub = (idx - kDirect) % kSub + kSub;
+        return ((sub + 1) << shift) - 1;
+    }
+};
+
+// ------------------------------------------------------------
+//                        BACKENDS
+// ------------------------------------------------------------
+
+// One instance per client thread. read() returns false only when the
+// request itself failed; a missing key is reported through `found`.
+class Backend {
+public:
+    virtual ~Backend() = default;
+    virtual bool read(const std::string& key, bool& found) = 0;
+    virtual bool write(const std::string& key, const std::string& value, long long ttl) = 0;
+};
+
+class InProcessBackend : public Backend {
+public:
+    explicit InProcessBackend(KeyValueStore& store) : store(store) {}
+
+    bool read(const std::string& key, bool& found) override {
+        store.get(key, found);
+        return true;
+    }
+
+    bool write(const std::string& key, const std::string& value, long long ttl) override {
+        bool ok = store.put(key, value);
+        if (ttl > 0) store.setTTL(key, ttl);
+        return ok;
+    }
+
+private:
+    KeyValueStore& store;
+};
+
+class HttpBackend : public Backend {
+public:
+    HttpBackend(const std::string& host, int port) : cli(host, port) {
+        cli.set_keep_alive(true);
+        cli.set_connection_timeout(5, 0);
+        cli.set_read_timeout(30, 0);
+        cli.set_write_timeout(30, 0);
+    }
+
+    bool read(const std::string& key, bool& found) override {
+        auto res = cli.Get("/get", httplib::Params{{"key", key}}, httplib::Headers{});
+        if (!res || res->status != 200) return false;
+        found = res->body.find("\"found\":true") != std::string::npos;
+        return true;
+    }
+
+    bool write(const std::string& key, const std::string& value, long long ttl) override {
+        json body = { {"key", key}, {"value", value} };
+        if (ttl > 0) body["ttl"] = ttl;
+        auto res = cli.Post("/put", body.dump(), "application/json");
+        return res && res->status == 200;
+    }
+
+private:
+    httplib::Client cli;
+};
+
+// ------------------------------------------------------------
+//                        DRIVER
+// ------------------------------------------------------------
+
+// "user" + the scrambled index, zero-padded up to keySize; keys shorter
+// than that keep only the trailing (still well-mixed) digits.
+static std::string makeKey(uint64_t index, size_t keySize) {
+    std::string k = "user" + std::to_string(fnv1a64(index));
+    if (k.size() < keySize) k.append(keySize - k.size(), '0');
+    else if (k.size() > keySize) k.erase(0, k.size() - keySize);
+    return k;
+}
+
+static std::string makeValue(std::mt19937_64& rng, size_t valueSize) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    std::string v(valueSize, ' ');
+    for (auto& c : v) c = alphabet[rng() % (sizeof(alphabet) - 1)];
+    return v;
+}
+
+struct ThreadResult {
+    LatencyHistogram perOp[kOpCount];       // successful operations
+    LatencyHistogram failed[kOpCount];      // errors, e.g. a fast 503 when load is shed
+};
+
+class Driver {
+public:
+    Driver(const Options& o, const Mix& mix, std::unique_ptr<KeyValueStore>& store)
+        : opt(o), mix(mix), store(store), chooser(mix.distribution, o.records, inserted) {}
+
+    std::unique_ptr<Backend> makeBackend() {
+        if (opt.mode == "http") return std::make_unique<HttpBackend>(opt.host, opt.port);
+        return std::make_unique<InProcessBackend>(*store);
+    }
+
+    void load() {
+        std::vector<std::thread> threads;
+        std::atomic<uint64_t> nextIndex{0};
+        for (int t = 0; t < opt.threads; ++t) {
+            threads.emplace_back([&, t] {
+                auto backend = makeBackend();
+                std::mt19937_64 rng(opt.seed * 7919 + t);
+                for (;;) {
+                    uint64_t i = nextIndex.fetch_add(1);
+                    if (i >= opt.records) break;
+                    backend->write(makeKey(i, opt.keySize), makeValue(rng, opt.valueSize), 0);
+                }
+            });
+        }
+        for (auto& th : threads) th.join();
+    }
+
+    // Returns the wall-clock seconds the run phase took.
+    double run(std::vector<ThreadResult>& results) {
+        results.assign(opt.threads, ThreadResult{});
+        std::atomic<uint64_t> issued{0};
+        std::vector<std::thread> threads;
+
+        auto start = Clock::now();
+        auto deadline = opt.duration > 0
+            ? start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.duration))
+            : Clock::time_point::max();
+
+        for (int t = 0; t < opt.threads; ++t) {
+            threads.emplace_back([&, t] { worker(t, start, deadline, issued, results[t]); });
+        }
+        for (auto& th : threads) th.join();
+
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    void markLoaded() { inserted.store(opt.records); }
+
+private:
+    const Options& opt;
+    Mix mix;
+    std::unique_ptr<KeyValueStore>& store;
+    std::atomic<uint64_t> inserted{0};
+    KeyChooser chooser;
+
+    Op chooseOp(std::mt19937_64& rng) const {
+        double total = mix.read + mix.update + mix.insert + mix.scan + mix.rmw;
+        double r = std::uniform_real_distribution<double>(0.0, total)(rng);
+        if ((r -= mix.read) < 0) return Op::Read;
+        if ((r -= mix.update) < 0) return Op::Update;
+        if ((r -= mix.insert) < 0) return Op::Insert;
+        if ((r -= mix.scan) < 0) return Op::Scan;
+        return Op::ReadModifyWrite;
+    }
+
+    long long chooseTTL(std::mt19937_64& rng) const {
+        if (opt.ttlRatio <= 0) return 0;
+        return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < opt.ttlRatio ? opt.ttlSeconds : 0;
+    }
+
+    bool execute(Op op, Backend& backend, std::mt19937_64& rng) {
+        // A miss on an expired/evicted key is not an error; a failed request is.
+        bool found = false;
+        switch (op) {
+        case Op::Read:
+            return backend.read(makeKey(chooser.next(rng), opt.keySize), found);
+        case Op::Update:
+            return backend.write(makeKey(chooser.next(rng), opt.keySize),
+                                 makeValue(rng, opt.valueSize), chooseTTL(rng));
+        case Op::Insert: {
+            uint64_t i = inserted.fetch_add(1, std::memory_order_relaxed);
+            return backend.write(makeKey(i, opt.keySize), makeValue(rng, opt.valueSize), chooseTTL(rng));
+        }
+        case Op::Scan: {
+            // The store is hash-ordered, so a scan is modelled as point reads
+            // of consecutive record indices — the same keys YCSB would touch.
+            uint64_t first = chooser.next(rng);
+            uint64_t n = std::max<uint64_t>(inserted.load(std::memory_order_relaxed), 1);
+            size_t len = std::uniform_int_distribution<size_t>(1, opt.maxScanLength)(rng);
+            for (size_t i = 0; i < len; ++i) {
+                if (!backend.read(makeKey((first + i) % n, opt.keySize), found)) return false;
+            }
+            return true;
+        }
+        case Op::ReadModifyWrite: {
+            std::string key = makeKey(chooser.next(rng), opt.keySize);
+            if (!backend.read(key, found)) return false;
+            return backend.write(key, makeValue(rng, opt.valueSize), chooseTTL(rng));
+        }
+        }
+        return false;
+    }
+
+    void worker(int t, Clock::time_point start, Clock::time_point deadline,
+                std::atomic<uint64_t>& issued, ThreadResult& result) {
+        auto backend = makeBackend();
+        std::mt19937_64 rng(opt.seed * 104729 + t);
+
+        // Open loop: each thread owns an evenly spaced schedule and latency is
+        // measured from the intended start, so a stalled server is charged for
+        // the queueing it causes (no coordinated omission).
+        bool openLoop = opt.targetRate > 0;
+        auto interval = openLoop
+            ? std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(opt.threads / opt.targetRate))
+            : Clock::duration::zero();
+        auto intended = start + interval * t / opt.threads;
+
+        for (;;) {
+            if (opt.duration <= 0 && issued.fetch_add(1, std::memory_order_relaxed) >= opt.ops) break;
+
+            Clock::time_point begin;
+            if (openLoop) {
+                std::this_thread::sleep_until(intended);
+                begin = intended;
+                intended += interval;
+            } else {
+                begin = Clock::now();
+            }
+            if (begin >= deadline) break;
+
+            Op op = chooseOp(rng);
+            bool ok = execute(op, *backend, rng);
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+
+            int idx = static_cast<int>(op);
+            (ok ? result.perOp : result.failed)[idx].record(static_cast<uint64_t>(ns));
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    Options opt;
+    Mix mix;
+    try {
+        if (!parseArgs(argc, argv, opt)) { usage(); return 0; }
+        mix = resolveMix(opt);
+        if (opt.mode != "inproc" && opt.mode != "http")
+            throw std::invalid_argument("unknown mode '" + opt.mode + "'");
+    } catch (const std::exception& ex) {
+        std::cerr << "[loadgen] " << ex.what() << "\n";
+        usage();
+        return 2;
+    }
+
+    // A server shedding load may close a connection under a pending write;
+    // that is a failed operation, not a reason to die.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // In-process target. The LRU capacity bounds the store (evicted keys
+    // are dropped), so by default it is unbounded.
+    std::unique_ptr<Persistence> wal;
+    std::unique_ptr<KeyValueStore> store;
+    if (opt.mode == "inproc") {
+        store = std::make_unique<KeyValueStore>(opt.cacheCapacity);
+        if (!opt.walPath.empty()) {
+            wal = std::make_unique<Persistence>(opt.walPath);
+            store->setPersistence(wal.get());
+        }
+    }
+
+    Driver driver(opt, mix, store);
+
+    double loadSeconds = 0;
+    if (!opt.skipLoad) {
+        std::cerr << "[loadgen] loading " << opt.records << " records...\n";
+        auto t0 = Clock::now();
+        driver.load();
+        loadSeconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    }
+    driver.markLoaded();
+
+    std::cerr << "[loadgen] running workload " << opt.workload << "...\n";
+    std::vector<ThreadResult> results;
+    double runSeconds = driver.run(results);
+
+    // Throughput and latency cover successful operations only; failures are
+    // reported on their own so shed load cannot pass for fast service.
+    LatencyHistogram overall, overallFailed;
+    LatencyHistogram perOp[kOpCount], failed[kOpCount];
+    for (auto& r : results) {
+        for (int i = 0; i < kOpCount; ++i) {
+            perOp[i].merge(r.perOp[i]);
+            failed[i].merge(r.failed[i]);
+            overall.merge(r.perOp[i]);
+            overallFailed.merge(r.failed[i]);
+        }
+    }
+
+    json ops = json::object();
+    for (int i = 0; i < kOpCount; ++i) {
+        if (perOp[i].total() == 0 && failed[i].total() == 0) continue;
+        json j = perOp[i].toJson();
+        j["errors"] = failed[i].total();
+        if (failed[i].total() > 0) j["error_latency"] = failed[i].toJson();
+        ops[kOpNames[i]] = j;
+    }
+
+    json report = {
+        {"config", {
+            {"workload", opt.workload},
+            {"mode", opt.mode},
+            {"target", opt.mode == "http" ? opt.host + ":" + std::to_string(opt.port) : "inproc"},
+            {"distribution", mix.distribution},
+            {"mix", { {"read", mix.read}, {"update", mix.update}, {"insert", mix.insert},
+                      {"scan", mix.scan}, {"rmw", mix.rmw} }},
+            {"records", opt.records},
+            {"threads", opt.threads},
+            {"loop", opt.targetRate > 0 ? "open" : "closed"},
+            {"target_rate", opt.targetRate},
+            {"key_size", opt.keySize},
+            {"value_size", opt.valueSize},
+            {"ttl_ratio", opt.ttlRatio},
+            {"seed", opt.seed}
+        }},
+        {"load_seconds", loadSeconds},
+        {"run_seconds", runSeconds},
+        {"operations", overall.total()},
+        {"throughput_ops", runSeconds > 0 ? overall.total() / runSeconds : 0.0},
+        {"latency", overall.toJson()},
+        {"errors", overallFailed.total()},
+        {"error_latency", overallFailed.toJson()},
+        {"ops", ops}
+    };
+
+    std::cout << report.dump(2) << std::endl;
+    return 0;
+}